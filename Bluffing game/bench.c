@@ -0,0 +1,1092 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "bench.h"
+
+// the benchmarks in the order they run and are printed
+static Benchmark BENCHMARKS[] = {
+  { "load_deck", benchLoadDeck, -1 },
+  { "deal", benchDeal, -1 },
+  { "hand", benchHand, -1 },
+  { "check_valid", benchCheckValid, CORPUS_VALID },
+  { "check_invalid", benchCheckInvalid, CORPUS_INVALID },
+  { "play", benchPlay, CORPUS_PLAY },
+  { "swap", benchSwap, CORPUS_SWAP },
+  { "challenge", benchChallenge, CORPUS_CHALLENGE },
+  { "draw", benchDraw, CORPUS_DRAW },
+  { "playout", benchPlayout, -1 }
+};
+
+// results of the benchmarks end up here so they are not optimised away
+static volatile uint64_t bench_sink;
+
+//------------------------------------------------------------------------------
+///
+/// Measures the hot functions of the engine on the deck of a config file and
+/// prints one line per benchmark: name, ns/op and allocations/op. Lines
+/// starting with # are comments, so the output of a run without a baseline
+/// can be stored as the baseline. With a baseline the ns/op and allocations/op
+/// of the baseline and the change of the time are added to each line. Move
+/// corpora and bot seeds are fixed, every benchmark is warmed up before it is
+/// measured
+///
+/// @param config_name config file
+/// @param baseline_name earlier output to compare with; NULL = none
+///
+/// @return 2 = file not open; 3 = not a valid file; 4 = alloc fail; 0 = End
+//
+int runBenchmarks(char* config_name, char* baseline_name)
+{
+  BenchContext context;
+  memset(&context, 0, sizeof(BenchContext));
+  context.config_name_ = config_name;
+  int load_check = loadDeck(config_name, &context.deck_);
+  if (load_check != 0)
+    return load_check;
+
+  FILE* baseline = (baseline_name != NULL) ? fopen(baseline_name, "r") : NULL;
+  if (baseline_name != NULL && baseline == NULL)
+  {
+    freeCards(&context.deck_);
+    printf("Error: Cannot open file: %s\n", baseline_name);
+    return CANT_OPEN_FILE;
+  }
+  if (baseline != NULL)
+    fclose(baseline);
+
+  if (collectCorpora(&context) != 0 ||
+      initialiseRenderer(&context.renderer_, RENDER_OFF, stdout) != 0)
+  {
+    for (int corpus = 0; corpus < CORPUS_COUNT; corpus++)
+      free(context.corpora_[corpus].cases_);
+    freeCards(&context.deck_);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+  initialiseSession(&context.session_, NULL, &context.renderer_);
+  for (int seat = 0; seat < 2; seat++)
+  {
+    context.session_.seats_[seat].provide_ = randomMove;
+    context.session_.seats_[seat].context_ = &context.bots_[seat];
+  }
+
+  printf(baseline_name == NULL ? "# benchmark ns/op allocs/op\n" :
+    "# benchmark ns/op allocs/op baseline_ns/op baseline_allocs/op change\n");
+  for (size_t index = 0; index < sizeof(BENCHMARKS) / sizeof(Benchmark); index++)
+  {
+    Benchmark* benchmark = &BENCHMARKS[index];
+    if (benchmark->corpus_ >= 0 && context.corpora_[benchmark->corpus_].count_ == 0)
+      continue;
+
+    double ns = 0;
+    double allocations = 0;
+    measureBenchmark(benchmark, &context, &ns, &allocations);
+    printf("%s %.1f ", benchmark->name_, ns);
+#ifdef ESP_COUNT_ALLOCATIONS
+    printf("%.2f", allocations);
+#else
+    printf("-");
+#endif
+    if (baseline_name != NULL)
+    {
+      double baseline_allocations = 0;
+      double baseline_ns = baselineValue(baseline_name, benchmark->name_, &baseline_allocations);
+      if (baseline_ns > 0)
+        printf(" %.1f %.2f %+.1f%%", baseline_ns, baseline_allocations, (ns / baseline_ns - 1.0) * 100.0);
+      else
+        printf(" - - -");
+    }
+    printf("\n");
+  }
+
+  for (int corpus = 0; corpus < CORPUS_COUNT; corpus++)
+    free(context.corpora_[corpus].cases_);
+  freeRenderer(&context.renderer_);
+  freeCards(&context.deck_);
+  return GAME_END;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Comparing two latencies for qsort
+///
+/// @param first latency
+/// @param second latency
+///
+/// @return < 0 = first is shorter; 0 = equal; > 0 = first is longer
+//
+static int compareLatencies(const void* first, const void* second)
+{
+  uint32_t a = *(const uint32_t*)first;
+  uint32_t b = *(const uint32_t*)second;
+  return (a > b) - (a < b);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Replays the games of a move file recorded by --simulate --record on the
+/// config file it was recorded with. The move lines go through the parser and
+/// the engine like piped input, one game after another until the lines run
+/// out, and the whole file is replayed REPLAY_ROUNDS times. Prints the move
+/// lines per second of the fastest round, the median and 99th percentile time
+/// from one move line to the next and the peak RSS, in the format of --bench.
+/// With a baseline every metric is compared and the replay fails when one of
+/// them is more than max_regression percent worse or missing from the baseline
+///
+/// @param moves_name move file
+/// @param config_name config file the moves were recorded on
+/// @param baseline_name earlier output to compare with; NULL = none
+/// @param max_regression percent a metric may get worse
+///
+/// @return 1 = a metric regressed or is missing; 2 = file not open; 3 = not a valid file;
+///         4 = alloc fail; 0 = End
+//
+int benchReplay(char* moves_name, char* config_name, char* baseline_name, double max_regression)
+{
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int load_check = loadDeck(config_name, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  FILE* baseline = (baseline_name != NULL) ? fopen(baseline_name, "r") : NULL;
+  if (baseline_name != NULL && baseline == NULL)
+  {
+    freeCards(&deck);
+    printf("Error: Cannot open file: %s\n", baseline_name);
+    return CANT_OPEN_FILE;
+  }
+  if (baseline != NULL)
+    fclose(baseline);
+
+  char* text = NULL;
+  ReplaySeat replay;
+  long bytes = 0;
+  load_check = loadLines(moves_name, &text, &replay.lines_, &replay.count_, &bytes);
+  if (load_check != 0)
+  {
+    freeCards(&deck);
+    return load_check;
+  }
+
+  Renderer renderer;
+  initialiseRenderer(&renderer, RENDER_OFF, stdout);
+  Session session;
+  initialiseSession(&session, NULL, &renderer);
+  for (int seat = 0; seat < 2; seat++)
+  {
+    session.seats_[seat].provide_ = replayMove;
+    session.seats_[seat].context_ = &replay;
+  }
+  replay.latencies_ = (uint32_t*)malloc((replay.count_ * REPLAY_ROUNDS + 1) * sizeof(uint32_t));
+  if (replay.latencies_ == NULL)
+  {
+    free(replay.lines_);
+    free(text);
+    freeCards(&deck);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  replay.turns_ = 0;
+  unsigned long games = 0;
+  double best = 0;
+  for (int round = 0; round < REPLAY_ROUNDS; round++)
+  {
+    replay.next_ = 0;
+    games = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (replay.next_ < replay.count_)
+    {
+      EspGame game;
+      clock_gettime(CLOCK_MONOTONIC, &replay.last_);
+      esp_game_init(&game, &deck);
+      if (gameplay(&session, &game) != QUIT)
+        games++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    best = (round == 0 || seconds < best) ? seconds : best;
+  }
+
+  qsort(replay.latencies_, replay.turns_, sizeof(uint32_t), compareLatencies);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double lines_per_second = (best > 0) ? (double)replay.count_ / best : 0.0;
+  double p50 = (replay.turns_ > 0) ? replay.latencies_[replay.turns_ / 2] : 0;
+  double p99 = (replay.turns_ > 0) ? replay.latencies_[replay.turns_ * 99 / 100] : 0;
+  double rss = (double)usage.ru_maxrss;
+
+  printf("# replayed %lu games, %zu move lines, best of %d rounds\n", games, replay.count_, REPLAY_ROUNDS);
+  printf(baseline_name == NULL ? "# metric value\n" : "# metric value baseline change\n");
+  bool passed = gateMetric(baseline_name, "turns_per_sec", lines_per_second, true, max_regression);
+  passed = gateMetric(baseline_name, "turn_p50_ns", p50, false, max_regression) && passed;
+  passed = gateMetric(baseline_name, "turn_p99_ns", p99, false, max_regression) && passed;
+  passed = gateMetric(baseline_name, "peak_rss_kb", rss, false, max_regression) && passed;
+  if (baseline_name != NULL)
+    printf(passed ? "# gate passed, no metric more than %.1f%% worse\n" :
+      "# gate failed, a metric is more than %.1f%% worse or missing\n", max_regression);
+
+  free(replay.latencies_);
+  free(replay.lines_);
+  free(text);
+  freeRenderer(&renderer);
+  freeCards(&deck);
+  return passed ? GAME_END : 1;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Move provider handing out the next line of a recorded run and noting the
+/// time since the last line was asked for
+///
+/// @param context ReplaySeat
+/// @param view state of the turn, not used
+/// @param line move line
+///
+/// @return -1 = no lines left; 0 = Valid
+//
+int replayMove(void* context, TurnView* view, char** line)
+{
+  ReplaySeat* replay = (ReplaySeat*)context;
+  (void)view;
+  if (replay->next_ == replay->count_)
+    return QUIT;
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t ns = (int64_t)(now.tv_sec - replay->last_.tv_sec) * 1000000000 + (now.tv_nsec - replay->last_.tv_nsec);
+  replay->latencies_[replay->turns_++] = (ns > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+  replay->last_ = now;
+
+  *line = replay->lines_[replay->next_++];
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Printing a metric of the replay and comparing it with the baseline
+///
+/// @param baseline_name earlier output; NULL = none
+/// @param name name of the metric
+/// @param value measured value
+/// @param higher_better true = a higher value is better
+/// @param max_regression percent the metric may get worse
+///
+/// @return false = more than max_regression percent worse or not in the
+///         baseline; true = passed
+//
+bool gateMetric(char* baseline_name, const char* name, double value, bool higher_better, double max_regression)
+{
+  printf("%s %.0f", name, value);
+  if (baseline_name == NULL)
+  {
+    printf("\n");
+    return true;
+  }
+
+  double allocations = 0;
+  double baseline = baselineValue(baseline_name, name, &allocations);
+  if (baseline <= 0)
+  {
+    printf(" - - MISSING\n");
+    return false;
+  }
+  if (value <= 0)
+  {
+    printf(" %.0f -%s\n", baseline, higher_better ? " REGRESSION" : "");
+    return !higher_better;
+  }
+
+  double change = (value / baseline - 1.0) * 100.0;
+  double regression = higher_better ? (baseline / value - 1.0) * 100.0 : change;
+  printf(" %.0f %+.1f%%%s\n", baseline, change, (regression > max_regression) ? " REGRESSION" : "");
+  return regression <= max_regression;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Collecting the move corpora from random games on the deck. In every state
+/// one random legal move of each kind and one random move the rules reject are
+/// taken until each corpus holds BENCH_CASES moves, then a random legal move
+/// other than quit is made
+///
+/// @param context context with the deck, gets the corpora
+///
+/// @return 4 = Mem error; 0 = Valid
+//
+int collectCorpora(BenchContext* context)
+{
+  for (int corpus = 0; corpus < CORPUS_COUNT; corpus++)
+  {
+    context->corpora_[corpus].cases_ = (BenchCase*)malloc(BENCH_CASES * sizeof(BenchCase));
+    context->corpora_[corpus].count_ = 0;
+    if (context->corpora_[corpus].cases_ == NULL)
+      return ALLOC_FAIL;
+  }
+  Move* moves = (Move*)malloc(ESP_MOVES_MAX * sizeof(Move));
+  if (moves == NULL)
+    return ALLOC_FAIL;
+
+  static const int KIND_CORPORA[] = { -1, CORPUS_PLAY, CORPUS_DRAW, CORPUS_CHALLENGE, CORPUS_SWAP, -1 };
+  uint64_t random = BENCH_SEED;
+  bool full = false;
+  for (int game_index = 0; game_index < BENCH_GAMES_MAX && !full; game_index++)
+  {
+    EspGame game;
+    esp_game_init(&game, &context->deck_);
+    int count;
+    while ((count = esp_legal_moves(&game, moves, ESP_MOVES_MAX)) > 0 && !full)
+    {
+      // a random legal move of each kind, walking the list from a random start
+      int start = (int)(nextRandom(&random) % (uint64_t)count);
+      bool taken[MOVE_QUIT + 1] = { false };
+      for (int offset = 0; offset < count; offset++)
+      {
+        Move* move = &moves[(start + offset) % count];
+        int corpus = KIND_CORPORA[move->kind_];
+        if (corpus < 0 || taken[move->kind_] || context->corpora_[corpus].count_ == BENCH_CASES)
+          continue;
+        taken[move->kind_] = true;
+        context->corpora_[corpus].cases_[context->corpora_[corpus].count_++] = (BenchCase){ game, *move };
+      }
+
+      Move made = moves[start];
+      if (made.kind_ == MOVE_QUIT)
+        made = moves[(start + 1) % count];
+      BenchCorpus* valid = &context->corpora_[CORPUS_VALID];
+      if (valid->count_ < BENCH_CASES)
+        valid->cases_[valid->count_++] = (BenchCase){ game, made };
+
+      Move wrong = { (uint8_t)(nextRandom(&random) % (MOVE_QUIT + 1)), (uint8_t)(nextRandom(&random) % 5),
+        (Card)(nextRandom(&random) % (CARD_KINDS + 1)), (Card)(nextRandom(&random) % (CARD_KINDS + 1)),
+        (uint8_t)(nextRandom(&random) % 3), (int)(nextRandom(&random) % 10) - 1 };
+      wrong.real_card_ = (wrong.real_card_ == CARD_KINDS) ? NO_CARD : wrong.real_card_;
+      wrong.played_card_ = (wrong.played_card_ == CARD_KINDS) ? NO_CARD : wrong.played_card_;
+      BenchCorpus* invalid = &context->corpora_[CORPUS_INVALID];
+      if (invalid->count_ < BENCH_CASES && esp_check(&game, &wrong) != ERROR_NONE)
+        invalid->cases_[invalid->count_++] = (BenchCase){ game, wrong };
+
+      esp_apply(&game, &made, NULL);
+
+      full = true;
+      for (int corpus = 0; corpus < CORPUS_COUNT; corpus++)
+        full = full && context->corpora_[corpus].count_ == BENCH_CASES;
+    }
+  }
+
+  // the hand benchmark works on a hand of every card kind with a few copies
+  memset(&context->hand_, 0, sizeof(Hand));
+  for (int card = 0; card < CARD_KINDS * 3; card++)
+    handAdd(&context->hand_, (Card)(card % CARD_KINDS));
+
+  free(moves);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Running a benchmark: one warmup call, then the number of operations is
+/// doubled until a call takes BENCH_MIN_SECONDS, and the fastest of
+/// BENCH_RUNS calls of that size is taken
+///
+/// @param benchmark benchmark
+/// @param context context of the benchmarks
+/// @param ns nanoseconds per operation
+/// @param allocations allocations per operation, over all measured calls
+///
+/// @return no return
+//
+void measureBenchmark(Benchmark* benchmark, BenchContext* context, double* ns, double* allocations)
+{
+  bench_sink = benchmark->run_(context, 1);
+
+  uint64_t ops = 1;
+  double best = 0;
+  struct timespec start, end;
+  while (true)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bench_sink = benchmark->run_(context, ops);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    best = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (best >= BENCH_MIN_SECONDS)
+      break;
+    ops *= 2;
+  }
+
+  size_t allocations_before = allocationCount();
+  for (int run = 0; run < BENCH_RUNS; run++)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bench_sink = benchmark->run_(context, ops);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    best = (seconds < best) ? seconds : best;
+  }
+
+  *ns = best * 1e9 / (double)ops;
+  *allocations = (double)(allocationCount() - allocations_before) / (double)(ops * BENCH_RUNS);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Looking up a benchmark in an earlier output
+///
+/// @param baseline_name earlier output of runBenchmarks
+/// @param name name of the benchmark
+/// @param allocations allocations per operation in the baseline
+///
+/// @return ns per operation; 0 = not in the baseline
+//
+double baselineValue(char* baseline_name, const char* name, double* allocations)
+{
+  FILE* baseline = fopen(baseline_name, "r");
+  if (baseline == NULL)
+    return 0;
+
+  char line[LINE_LENGTH_MAX];
+  double ns = 0;
+  while (fgets(line, sizeof(line), baseline) != NULL)
+  {
+    char line_name[BENCH_NAME_LENGTH];
+    double line_ns = 0;
+    if (line[0] == '#' || sscanf(line, "%31s %lf", line_name, &line_ns) != 2 || strcmp(line_name, name) != 0)
+      continue;
+
+    ns = line_ns;
+    if (sscanf(line, "%*s %*f %lf", allocations) != 1)
+      *allocations = 0;
+    break;
+  }
+
+  fclose(baseline);
+  return ns;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Loading the config file into a draw pile and freeing it again
+///
+/// @param context context with the config file name
+/// @param ops number of loads
+///
+/// @return cards loaded
+//
+uint64_t benchLoadDeck(BenchContext* context, uint64_t ops)
+{
+  uint64_t sum = 0;
+  for (uint64_t op = 0; op < ops; op++)
+  {
+    DrawPile deck = { NULL, 0, 0, 0 };
+    size_t error_line = 0;
+    if (extractCardsFromFile(context->config_name_, 1, &deck, &error_line) == 0)
+      sum += deck.size_;
+    freeCards(&deck);
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Starting a game on the deck, which deals six cards to each player
+///
+/// @param context context with the deck
+/// @param ops number of games started
+///
+/// @return sum of the dealt hands
+//
+uint64_t benchDeal(BenchContext* context, uint64_t ops)
+{
+  uint64_t sum = 0;
+  for (uint64_t op = 0; op < ops; op++)
+  {
+    EspGame game;
+    esp_game_init(&game, &context->deck_);
+    sum += handPresent(&game.state_.players_[0].hand_) + game.state_.players_[1].hand_.counts_[0];
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Adding a card to a hand, finding a card by its index in the printed order
+/// and removing the card again
+///
+/// @param context context with the hand
+/// @param ops number of add, index and remove triples
+///
+/// @return sum of the cards found
+//
+uint64_t benchHand(BenchContext* context, uint64_t ops)
+{
+  Hand* hand = &context->hand_;
+  int size = handSize(hand) + 1;
+  uint64_t sum = 0;
+  for (uint64_t op = 0; op < ops; op++)
+  {
+    Card card = (Card)(op % CARD_KINDS);
+    handAdd(hand, card);
+    sum += handNth(hand, (int)(op % (uint64_t)size));
+    handRemove(hand, card);
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking the moves of a corpus with esp_check
+///
+/// @param corpus moves and the games they are checked in
+/// @param ops number of checks
+///
+/// @return sum of the errors
+//
+static uint64_t checkCorpus(BenchCorpus* corpus, uint64_t ops)
+{
+  uint64_t sum = 0;
+  size_t index = 0;
+  for (uint64_t op = 0; op < ops; op++)
+  {
+    sum += (uint64_t)esp_check(&corpus->cases_[index].game_, &corpus->cases_[index].move_);
+    index = (index + 1 == corpus->count_) ? 0 : index + 1;
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Making the moves of a corpus with esp_apply, each on a copy of its game
+///
+/// @param corpus moves and the games they are made in
+/// @param ops number of moves made
+///
+/// @return sum of the points scored and cards drawn
+//
+static uint64_t applyCorpus(BenchCorpus* corpus, uint64_t ops)
+{
+  uint64_t sum = 0;
+  size_t index = 0;
+  for (uint64_t op = 0; op < ops; op++)
+  {
+    EspGame game = corpus->cases_[index].game_;
+    EspOutcome outcome;
+    esp_apply(&game, &corpus->cases_[index].move_, &outcome);
+    sum += (uint64_t)outcome.points_ + game.state_.pile_next_;
+    index = (index + 1 == corpus->count_) ? 0 : index + 1;
+  }
+  return sum;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking legal moves of random game states
+///
+/// @param context context with the corpora
+/// @param ops number of checks
+///
+/// @return sum of the errors
+//
+uint64_t benchCheckValid(BenchContext* context, uint64_t ops)
+{
+  return checkCorpus(&context->corpora_[CORPUS_VALID], ops);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking random moves the rules reject
+///
+/// @param context context with the corpora
+/// @param ops number of checks
+///
+/// @return sum of the errors
+//
+uint64_t benchCheckInvalid(BenchContext* context, uint64_t ops)
+{
+  return checkCorpus(&context->corpora_[CORPUS_INVALID], ops);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Playing a card, including the copy of the game
+///
+/// @param context context with the corpora
+/// @param ops number of plays
+///
+/// @return sum of the outcomes
+//
+uint64_t benchPlay(BenchContext* context, uint64_t ops)
+{
+  return applyCorpus(&context->corpora_[CORPUS_PLAY], ops);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Swapping a card with the opponent, including the copy of the game
+///
+/// @param context context with the corpora
+/// @param ops number of swaps
+///
+/// @return sum of the outcomes
+//
+uint64_t benchSwap(BenchContext* context, uint64_t ops)
+{
+  return applyCorpus(&context->corpora_[CORPUS_SWAP], ops);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Resolving a challenge with the points and draws that follow, including
+/// the copy of the game
+///
+/// @param context context with the corpora
+/// @param ops number of challenges
+///
+/// @return sum of the outcomes
+//
+uint64_t benchChallenge(BenchContext* context, uint64_t ops)
+{
+  return applyCorpus(&context->corpora_[CORPUS_CHALLENGE], ops);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Drawing a card, including the copy of the game
+///
+/// @param context context with the corpora
+/// @param ops number of draws
+///
+/// @return sum of the outcomes
+//
+uint64_t benchDraw(BenchContext* context, uint64_t ops)
+{
+  return applyCorpus(&context->corpora_[CORPUS_DRAW], ops);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Playing complete games between the random bots of the front-end, moves go
+/// through the move lines and the parser like in --simulate. Game n always
+/// uses the same bot seeds
+///
+/// @param context context with the deck and the session
+/// @param ops number of games
+///
+/// @return sum of the turns
+//
+uint64_t benchPlayout(BenchContext* context, uint64_t ops)
+{
+  Session* session = &context->session_;
+  session->turns_ = 0;
+  for (uint64_t op = 0; op < ops; op++)
+  {
+    for (int seat = 0; seat < 2; seat++)
+      context->bots_[seat].state_ = counterRandom(BENCH_SEED, op, (uint64_t)seat);
+    EspGame game;
+    esp_game_init(&game, &context->deck_);
+    gameplay(session, &game);
+  }
+  return session->turns_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checks that esp_unmake takes back every move exactly. In random games every
+/// legal move of every turn is made and unmade, then the game is played on
+/// with a random move. At the end all moves of the game are unmade again, which
+/// has to lead back to the start of the game
+///
+/// @param file_name config file
+/// @param games number of games
+///
+/// @return 1 = a move was not taken back exactly; 2 = file not open;
+///         3 = not a valid file; 4 = alloc fail; 0 = End
+//
+int verifyUndo(char* file_name, unsigned long games)
+{
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int load_check = loadDeck(file_name, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  Move* moves = (Move*)malloc(ESP_MOVES_MAX * sizeof(Move));
+  bool out_of_memory = moves == NULL;
+  EspUndo* history = NULL;
+  size_t capacity = 0;
+  uint64_t random = 1;
+  unsigned long checked = 0;
+  unsigned long failed = 0;
+
+  for (unsigned long game_index = 0; game_index < games && !out_of_memory; game_index++)
+  {
+    EspGame game;
+    EspGame start;
+    EspGame before;
+    esp_game_init(&game, &deck);
+    esp_game_clone(&start, &game);
+    size_t made = 0;
+
+    while (esp_is_over(&game) == 0)
+    {
+      int count = esp_legal_moves(&game, moves, ESP_MOVES_MAX);
+      esp_game_clone(&before, &game);
+      for (int i = 0; i < count; i++)
+      {
+        EspUndo undo;
+        esp_make(&game, &moves[i], NULL, &undo);
+        esp_unmake(&game, &undo);
+        checked++;
+        if (memcmp(&game, &before, sizeof(EspGame)) != 0)
+        {
+          failed++;
+          esp_game_clone(&game, &before);
+        }
+      }
+
+      if (count < 2) // nothing but quit
+        break;
+      if (made == capacity)
+      {
+        capacity = (capacity == 0) ? 256 : capacity * 2;
+        EspUndo* history_temp = (EspUndo*)realloc(history, capacity * sizeof(EspUndo));
+        if (history_temp == NULL)
+        {
+          out_of_memory = true;
+          break;
+        }
+        history = history_temp;
+      }
+      Move* move = &moves[1 + nextRandom(&random) % (uint64_t)(count - 1)]; // quit is not played
+      esp_make(&game, move, NULL, &history[made++]);
+    }
+
+    while (made > 0)
+      esp_unmake(&game, &history[--made]);
+    checked++;
+    if (memcmp(&game, &start, sizeof(EspGame)) != 0)
+      failed++;
+  }
+
+  free(history);
+  free(moves);
+  freeCards(&deck);
+  if (out_of_memory)
+  {
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  printf("Checked %lu make/unmake round trips in %lu games, %lu failed\n", checked, games, failed);
+  return (failed == 0) ? GAME_END : 1;
+}
+
+#ifdef ESP_VERIFY_RULES
+//------------------------------------------------------------------------------
+///
+/// Checks that the rule tables of libesp decide every move in every state the
+/// same way as the validation functions they were compiled from
+///
+/// @return 1 = the tables differ; 0 = End
+//
+int verifyRules(void)
+{
+  unsigned long mismatches = esp_verify_rules();
+  printf("Rule tables: %lu moves decided differently\n", mismatches);
+  return (mismatches == 0) ? GAME_END : 1;
+}
+#endif // ESP_VERIFY_RULES
+
+//------------------------------------------------------------------------------
+///
+/// Searches all move sequences up to a depth from the start of a game, once
+/// copying the game for every move and once with esp_make/esp_unmake on one
+/// game, and reports the speed of both
+///
+/// @param file_name config file
+/// @param depth number of moves to look ahead
+///
+/// @return 2 = file not open; 3 = not a valid file; 4 = alloc fail; 0 = End
+//
+int benchSearch(char* file_name, int depth)
+{
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int load_check = loadDeck(file_name, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  EspGame game;
+  esp_game_init(&game, &deck);
+
+  // best of three runs each, alternating between the two searches
+  unsigned long copy_nodes = 0;
+  unsigned long make_nodes = 0;
+  double copy_seconds = 0;
+  double make_seconds = 0;
+  for (int run = 0; run < 3; run++)
+  {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    copy_nodes = searchCopy(&game, depth);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (run == 0 || seconds < copy_seconds)
+      copy_seconds = seconds;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    make_nodes = searchMake(&game, depth);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (run == 0 || seconds < make_seconds)
+      make_seconds = seconds;
+  }
+
+  printf("Depth %d: %lu nodes\n", depth, copy_nodes);
+  printf("copy:        %.3f s, %.1f M nodes/s\n", copy_seconds, (double)copy_nodes / copy_seconds / 1e6);
+  printf("make/unmake: %.3f s, %.1f M nodes/s\n", make_seconds, (double)make_nodes / make_seconds / 1e6);
+  if (make_nodes != copy_nodes)
+    printf("Error: make/unmake searched %lu nodes\n", make_nodes);
+
+  freeCards(&deck);
+  return GAME_END;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Counting the games reachable within a depth, copying the game for every
+/// move. Quit is not searched
+///
+/// @param game game, not changed
+/// @param depth number of moves to look ahead
+///
+/// @return number of searched games
+//
+unsigned long searchCopy(EspGame* game, int depth)
+{
+  if (depth == 0 || esp_is_over(game) != 0)
+    return 1;
+
+  Move moves[ESP_MOVES_MAX];
+  int count = esp_legal_moves(game, moves, ESP_MOVES_MAX);
+  unsigned long nodes = 1;
+  for (int i = 1; i < count; i++)
+  {
+    EspGame child;
+    esp_game_clone(&child, game);
+    esp_apply(&child, &moves[i], NULL);
+    nodes += searchCopy(&child, depth - 1);
+  }
+  return nodes;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Counting the games reachable within a depth, making and unmaking the moves
+/// on the game itself. Quit is not searched
+///
+/// @param game game, the same again on return
+/// @param depth number of moves to look ahead
+///
+/// @return number of searched games
+//
+unsigned long searchMake(EspGame* game, int depth)
+{
+  if (depth == 0 || esp_is_over(game) != 0)
+    return 1;
+
+  Move moves[ESP_MOVES_MAX];
+  int count = esp_legal_moves(game, moves, ESP_MOVES_MAX);
+  unsigned long nodes = 1;
+  for (int i = 1; i < count; i++)
+  {
+    EspUndo undo;
+    esp_make(game, &moves[i], NULL, &undo);
+    nodes += searchMake(game, depth - 1);
+    esp_unmake(game, &undo);
+  }
+  return nodes;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Parses every line of a recorded move file over and over for about a second
+/// and reports the parser throughput
+///
+/// @param file_name file with one move line per line, e.g. from --record
+///
+/// @return 2 = file not open; 3 = empty file; 4 = alloc fail; 0 = End
+//
+int benchParse(char* file_name)
+{
+  char* text = NULL;
+  char** lines = NULL;
+  size_t line_count = 0;
+  long bytes = 0;
+  int load_check = loadLines(file_name, &text, &lines, &line_count, &bytes);
+  if (load_check != 0)
+    return load_check;
+
+  unsigned long rounds = 0;
+  unsigned long kinds[MOVE_QUIT + 1] = { 0 };
+  double seconds = 0;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (seconds < 1.0 || rounds == 0)
+  {
+    for (size_t i = 0; i < line_count; i++)
+    {
+      Move move;
+      parseMove(lines[i], &move);
+      kinds[move.kind_]++;
+    }
+    rounds++;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+  }
+
+  printf("Parsed %zu lines (%ld bytes) %lu times in %.3f s\n", line_count, bytes, rounds, seconds);
+  printf("%.1f ns/line, %.1f MB/s\n", seconds * 1e9 / (double)(line_count * rounds),
+    (double)bytes * (double)rounds / seconds / 1e6);
+  printf("play %lu, draw %lu, challenge %lu, swap %lu, quit %lu, invalid %lu\n",
+    kinds[MOVE_PLAY] / rounds, kinds[MOVE_DRAW] / rounds, kinds[MOVE_CHALLENGE] / rounds,
+    kinds[MOVE_SWAP] / rounds, kinds[MOVE_QUIT] / rounds, kinds[MOVE_INVALID] / rounds);
+
+  free(lines);
+  free(text);
+  return GAME_END;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Reading a file into memory and splitting it into lines, the lines point
+/// into the text
+///
+/// @param file_name file
+/// @param text contents of the file, to be freed
+/// @param lines start of every line, to be freed
+/// @param line_count number of lines
+/// @param bytes size of the file
+///
+/// @return 2 = file not open; 3 = empty file; 4 = alloc fail; 0 = Valid
+//
+int loadLines(char* file_name, char** text, char*** lines, size_t* line_count, long* bytes)
+{
+  FILE* file = fopen(file_name, "rb");
+  if (file == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    return CANT_OPEN_FILE;
+  }
+  fseek(file, 0, SEEK_END);
+  *bytes = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  *text = (char*)malloc((size_t)*bytes + 1);
+  if (*text == NULL || fread(*text, 1, (size_t)*bytes, file) != (size_t)*bytes)
+  {
+    free(*text);
+    fclose(file);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+  fclose(file);
+  (*text)[*bytes] = '\0';
+
+  *line_count = 0;
+  for (long i = 0; i < *bytes; i++)
+  {
+    if ((*text)[i] == '\n')
+      (*line_count)++;
+  }
+  *lines = (char**)malloc((*line_count + 1) * sizeof(char*));
+  if (*lines == NULL)
+  {
+    free(*text);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+  if (*bytes == 0)
+  {
+    free(*lines);
+    free(*text);
+    printf("Error: Invalid file: %s\n", file_name);
+    return INVALID_FILE;
+  }
+  *line_count = 0;
+  for (char* line = *text; *line != '\0';)
+  {
+    char* end = strchr(line, '\n');
+    (*lines)[(*line_count)++] = line;
+    if (end == NULL)
+      break;
+    *end = '\0';
+    line = end + 1;
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Loads a config file three times and reports the fastest load
+///
+/// @param file_name config file
+/// @param threads number of threads to parse with; 0 = by the size of the file
+///
+/// @return 2 = file not open; 3 = not a valid file; 4 = alloc fail; 0 = End
+//
+int benchLoad(char* file_name, int threads)
+{
+  struct stat info;
+  if (stat(file_name, &info) != 0)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    return CANT_OPEN_FILE;
+  }
+  if (threads <= 0)
+    threads = loadThreads((size_t)info.st_size);
+
+  double best = 0;
+  size_t cards = 0;
+  for (int run = 0; run < 3; run++)
+  {
+    DrawPile deck = { NULL, 0, 0, 0 };
+    size_t error_line = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int extraction_check = extractCardsFromFile(file_name, threads, &deck, &error_line);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (extraction_check == 1)
+    {
+      printf("Error: Cannot open file: %s\n", file_name);
+      return CANT_OPEN_FILE;
+    }
+    else if (extraction_check == 2)
+    {
+      if (error_line == 0)
+        printf("Error: Invalid file: %s\n", file_name);
+      else
+        printf("Error: Invalid file: %s (line %zu)\n", file_name, error_line);
+      return INVALID_FILE;
+    }
+    else if (extraction_check == 3)
+    {
+      printf("Error: Out of memory\n");
+      return ALLOC_FAIL;
+    }
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (run == 0 || seconds < best)
+      best = seconds;
+    cards = deck.size_;
+    freeCards(&deck);
+  }
+
+  printf("Loaded %zu cards (%lld bytes) on %d threads in %.3f s\n", cards, (long long)info.st_size,
+    threads, best);
+  printf("%.1f MB/s, %.1f M cards/s\n", (double)info.st_size / best / 1e6, (double)cards / best / 1e6);
+  return GAME_END;
+}
@@ -0,0 +1,128 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "main.h"
+
+#define BENCH_SEED 20240611
+#define BENCH_CASES 4096
+#define BENCH_GAMES_MAX 100000
+#define BENCH_MIN_SECONDS 0.05
+#define BENCH_RUNS 5
+#define BENCH_NAME_LENGTH 32
+#define REPLAY_ROUNDS 5
+#define REPLAY_MAX_REGRESSION 25.0
+
+// corpora of the move benchmarks
+enum {
+  CORPUS_VALID,
+  CORPUS_INVALID,
+  CORPUS_PLAY,
+  CORPUS_SWAP,
+  CORPUS_CHALLENGE,
+  CORPUS_DRAW,
+  CORPUS_COUNT
+};
+
+// a game in some state and a move for the player in turn
+typedef struct _BenchCase_
+{
+  EspGame game_;
+  Move move_;
+} BenchCase;
+
+typedef struct _BenchCorpus_
+{
+  BenchCase* cases_;
+  size_t count_;
+} BenchCorpus;
+
+// everything a benchmark may use, built once before the first one runs
+typedef struct _BenchContext_
+{
+  char* config_name_;
+  DrawPile deck_;
+  BenchCorpus corpora_[CORPUS_COUNT];
+  Hand hand_;        // hand of the hand benchmark, about half full
+  Session session_;  // random bots for the playouts
+  Renderer renderer_;
+  RandomBot bots_[2];
+} BenchContext;
+
+// runs ops operations, the returned sum keeps the compiler from dropping them
+typedef uint64_t (*BenchFunction)(BenchContext* context, uint64_t ops);
+
+typedef struct _Benchmark_
+{
+  const char* name_;
+  BenchFunction run_;
+  int corpus_;       // corpus that has to be non-empty; -1 = none
+} Benchmark;
+
+// move lines of a recorded run, handed to both seats one after another
+typedef struct _ReplaySeat_
+{
+  char** lines_;
+  size_t count_;
+  size_t next_;
+  uint32_t* latencies_;   // ns between two move lines being asked for
+  size_t turns_;
+  struct timespec last_;  // when the last move line was asked for
+} ReplaySeat;
+
+int runBenchmarks(char* config_name, char* baseline_name);
+
+int benchReplay(char* moves_name, char* config_name, char* baseline_name, double max_regression);
+
+int replayMove(void* context, TurnView* view, char** line);
+
+bool gateMetric(char* baseline_name, const char* name, double value, bool higher_better, double max_regression);
+
+int collectCorpora(BenchContext* context);
+
+void measureBenchmark(Benchmark* benchmark, BenchContext* context, double* ns, double* allocations);
+
+double baselineValue(char* baseline_name, const char* name, double* allocations);
+
+uint64_t benchLoadDeck(BenchContext* context, uint64_t ops);
+
+uint64_t benchDeal(BenchContext* context, uint64_t ops);
+
+uint64_t benchHand(BenchContext* context, uint64_t ops);
+
+uint64_t benchCheckValid(BenchContext* context, uint64_t ops);
+
+uint64_t benchCheckInvalid(BenchContext* context, uint64_t ops);
+
+uint64_t benchPlay(BenchContext* context, uint64_t ops);
+
+uint64_t benchSwap(BenchContext* context, uint64_t ops);
+
+uint64_t benchChallenge(BenchContext* context, uint64_t ops);
+
+uint64_t benchDraw(BenchContext* context, uint64_t ops);
+
+uint64_t benchPlayout(BenchContext* context, uint64_t ops);
+
+int verifyUndo(char* file_name, unsigned long games);
+
+#ifdef ESP_VERIFY_RULES
+int verifyRules(void);
+#endif
+
+int benchSearch(char* file_name, int depth);
+
+unsigned long searchCopy(EspGame* game, int depth);
+
+unsigned long searchMake(EspGame* game, int depth);
+
+int benchParse(char* file_name);
+
+int loadLines(char* file_name, char** text, char*** lines, size_t* line_count, long* bytes);
+
+int benchLoad(char* file_name, int threads);
+
+#endif // BENCH_H
@@ -0,0 +1,674 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cfr.h"
+
+static int cfrInfoset(EspGame* game, uint8_t legal);
+static uint32_t maskRow(MoveMask* mask, int offset);
+static int bucket(int value, const int* limits, int buckets);
+static double gameValue(EspGame* game, int player);
+
+// lowest value of every bucket but the first
+static const int HAND_LIMITS[CFR_HAND_BUCKETS - 1] = { 1, 2, 3, 5, 8 };
+static const int OPPONENT_LIMITS[CFR_OPPONENT_BUCKETS - 1] = { 1, 2, 3, 5 };
+static const int PLAYED_LIMITS[CFR_PLAYED_BUCKETS - 1] = { 1, 2, 3, 4, 6 };
+static const int PILE_LIMITS[CFR_PILE_BUCKETS - 1] = { 4, 8, 16, 32 };
+
+//------------------------------------------------------------------------------
+///
+/// Training a strategy table with Monte Carlo CFR on games dealt from a
+/// config file. Every iteration deals the deck shuffled by the seed and the
+/// iteration, player 1 traverses even and player 2 odd iterations. The
+/// threads share the regrets and strategy sums and add to them without locks
+///
+/// @param config_name config file
+/// @param table_name strategy table to write
+/// @param iterations games to train on
+/// @param threads training threads
+/// @param seed seed of the shuffles and samples
+///
+/// @return 1 = wrong usage; 2 = file not open or written; 3 = not a valid file;
+///         4 = alloc fail; 0 = End
+//
+int trainCfr(char* config_name, char* table_name, unsigned long iterations, int threads, uint64_t seed)
+{
+  if (threads <= 0 || threads > CFR_THREADS_MAX)
+  {
+    printf("%s", USAGE);
+    return WRONG_USAGE;
+  }
+
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int load_check = loadDeck(config_name, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  // tables, trainers, threads and shuffled decks live in one arena
+  size_t table_bytes = (size_t)CFR_INFOSETS * CFR_ACTIONS * sizeof(int64_t);
+  size_t deck_bytes = (deck.size_ == 0) ? 1 : deck.size_;
+  Arena arena;
+  if (initialiseArena(&arena, 2 * table_bytes + (size_t)threads * (sizeof(CfrTrainer) + sizeof(pthread_t) +
+      deck_bytes + 3 * ARENA_ALIGN) + 2 * ARENA_ALIGN) != 0)
+  {
+    freeCards(&deck);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  CfrTables tables;
+  tables.regrets_ = (_Atomic int64_t*)arenaAlloc(&arena, table_bytes);
+  tables.strategy_ = (_Atomic uint64_t*)arenaAlloc(&arena, table_bytes);
+  memset((void*)tables.regrets_, 0, table_bytes);
+  memset((void*)tables.strategy_, 0, table_bytes);
+  CfrTrainer* trainers = (CfrTrainer*)arenaAlloc(&arena, (size_t)threads * sizeof(CfrTrainer));
+  pthread_t* pool = (pthread_t*)arenaAlloc(&arena, (size_t)threads * sizeof(pthread_t));
+  bool* started = (bool*)arenaAlloc(&arena, (size_t)threads * sizeof(bool));
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int index = 0; index < threads; index++)
+  {
+    CfrTrainer* trainer = &trainers[index];
+    trainer->index_ = index;
+    trainer->threads_ = threads;
+    trainer->iterations_ = iterations;
+    trainer->seed_ = seed;
+    trainer->deck_ = &deck;
+    trainer->cards_ = (Card*)arenaAlloc(&arena, deck_bytes);
+    trainer->tables_ = &tables;
+    trainer->evaluations_ = 0;
+    started[index] = pthread_create(&pool[index], NULL, runCfrTrainer, trainer) == 0;
+  }
+
+  // the share of a thread that could not be started is trained here
+  unsigned long evaluations = 0;
+  for (int index = 0; index < threads; index++)
+  {
+    if (started[index])
+      pthread_join(pool[index], NULL);
+    else
+      runCfrTrainer(&trainers[index]);
+    evaluations += trainers[index].evaluations_;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+  int visited = 0;
+  for (int infoset = 0; infoset < CFR_INFOSETS; infoset++)
+  {
+    for (int action = 0; action < CFR_ACTIONS; action++)
+    {
+      if (atomic_load_explicit(&tables.strategy_[infoset * CFR_ACTIONS + action], memory_order_relaxed) != 0)
+      {
+        visited++;
+        break;
+      }
+    }
+  }
+
+  int write_check = writeCfrTable(table_name, &tables);
+  freeArena(&arena);
+  freeCards(&deck);
+  if (write_check != 0)
+  {
+    printf("Error: Cannot open file: %s\n", table_name);
+    return CANT_OPEN_FILE;
+  }
+
+  printf("Trained %lu iterations on %d threads in %.3f s (%.0f iterations/sec, %lu decisions evaluated)\n",
+    iterations, threads, seconds, (seconds > 0) ? (double)iterations / seconds : 0.0, evaluations);
+  printf("%d of %d information sets visited, table written to %s\n", visited, CFR_INFOSETS, table_name);
+  return GAME_END;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Thread of a trainer, runs every threads_-th iteration starting at index_
+///
+/// @param argument CfrTrainer
+///
+/// @return NULL
+//
+void *runCfrTrainer(void* argument)
+{
+  CfrTrainer* trainer = (CfrTrainer*)argument;
+  DrawPile* deck = trainer->deck_;
+  for (unsigned long iteration = (unsigned long)trainer->index_; iteration < trainer->iterations_;
+       iteration += (unsigned long)trainer->threads_)
+  {
+    memcpy(trainer->cards_, deck->cards_, deck->size_);
+    shuffleCards(trainer->cards_, deck->size_, trainer->seed_, iteration);
+    DrawPile pile = { trainer->cards_, deck->size_, 0, 0 };
+    EspGame game;
+    esp_game_init(&game, &pile);
+
+    // the shuffle used the counters below the deck size. Later iterations weigh
+    // more, scaled to the run so the strategy sums cannot overflow
+    uint64_t random = counterRandom(trainer->seed_, iteration, deck->size_);
+    uint64_t weight = 1 + (uint64_t)((unsigned __int128)iteration * CFR_WEIGHT_MAX / trainer->iterations_);
+    cfrTraverse(trainer, &game, 1 + (int)(iteration % 2), weight, &random);
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// One iteration: both players play the current strategy to the end of the
+/// game. At every decision of the traverser the strategy is added to the
+/// strategy sums, and every legal action is valued by CFR_PLAYOUTS playouts
+/// to the end of the game, a win is worth 1 and a loss -1. The regrets of the
+/// actions against the strategy are added with regret matching+, a
+/// compare-and-swap per action
+///
+/// @param trainer trainer with the shared tables
+/// @param game game at its start
+/// @param traverser player whose regrets are updated
+/// @param weight weight of the strategies of this iteration
+/// @param random random number state
+///
+/// @return number of decisions evaluated
+//
+int cfrTraverse(CfrTrainer* trainer, EspGame* game, int traverser, uint64_t weight, uint64_t* random)
+{
+  CfrTables* tables = trainer->tables_;
+  int evaluated = 0;
+  for (int turn = 0; turn < CFR_TURNS_MAX && esp_is_over(game) == 0; turn++)
+  {
+    CfrChoice choice;
+    double strategy[CFR_ACTIONS];
+    cfrChoices(game, &choice, random);
+    if (choice.legal_ == 0)
+      break;
+    cfrStrategy(tables, &choice, strategy);
+    int action_taken = sampleAction(strategy, random);
+
+    if (game->state_.curr_player_ == traverser)
+    {
+      size_t row = (size_t)choice.infoset_ * CFR_ACTIONS;
+      for (int action = 0; action < CFR_ACTIONS; action++)
+      {
+        if (strategy[action] > 0)
+          atomic_fetch_add_explicit(&tables->strategy_[row + action], (uint64_t)(strategy[action] * CFR_SCALE) * weight,
+            memory_order_relaxed);
+      }
+
+      // all actions are played out on the same random numbers, so their values
+      // differ by the action and not by the luck of the playouts
+      double values[CFR_ACTIONS] = { 0 };
+      double expected = 0;
+      for (int playout = 0; playout < CFR_PLAYOUTS; playout++)
+      {
+        uint64_t playout_random = nextRandom(random);
+        for (int action = 0; action < CFR_ACTIONS; action++)
+        {
+          if ((choice.legal_ & (1u << action)) == 0)
+            continue;
+          EspGame branch = *game;
+          esp_apply(&branch, &choice.moves_[action], NULL);
+          values[action] += cfrPlayout(trainer, &branch, traverser, turn + 1, &playout_random) / CFR_PLAYOUTS;
+        }
+      }
+      for (int action = 0; action < CFR_ACTIONS; action++)
+        expected += strategy[action] * values[action];
+
+      for (int action = 0; action < CFR_ACTIONS; action++)
+      {
+        if ((choice.legal_ & (1u << action)) == 0)
+          continue;
+        int64_t regret = (int64_t)((values[action] - expected) * CFR_SCALE);
+        _Atomic int64_t* cell = &tables->regrets_[row + action];
+        int64_t old = atomic_load_explicit(cell, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(cell, &old, (old + regret > 0) ? old + regret : 0,
+               memory_order_relaxed, memory_order_relaxed))
+          ;
+      }
+      evaluated++;
+    }
+
+    esp_apply(game, &choice.moves_[action_taken], NULL);
+  }
+  trainer->evaluations_ += (unsigned long)evaluated;
+  return evaluated;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Playing a game out with the current strategy of both players
+///
+/// @param trainer trainer with the shared tables
+/// @param game game to play out
+/// @param traverser player the result is valued for
+/// @param turn turns played so far, the game is cut at CFR_TURNS_MAX
+/// @param random start of the random numbers of the playout, left unchanged
+///
+/// @return value of the result for the traverser, see gameValue
+//
+double cfrPlayout(CfrTrainer* trainer, EspGame* game, int traverser, int turn, uint64_t* random)
+{
+  for (; turn < CFR_TURNS_MAX && esp_is_over(game) == 0; turn++)
+  {
+    CfrChoice choice;
+    double strategy[CFR_ACTIONS];
+    // each turn takes its numbers from its own place in the stream, so the
+    // playouts of the actions of a decision stay alike while their games do
+    uint64_t step = *random + (uint64_t)turn * 2 * 0x9E3779B97F4A7C15ULL;
+    cfrChoices(game, &choice, &step);
+    if (choice.legal_ == 0)
+      break;
+    cfrStrategy(trainer->tables_, &choice, strategy);
+    esp_apply(game, &choice.moves_[sampleAction(strategy, &step)], NULL);
+  }
+  return gameValue(game, traverser);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Abstract state of the player in turn and one legal move for each legal
+/// action, read off the legal move mask. An honest play plays the lowest card
+/// that may be claimed. A bluff claims the lowest claim not in the hand, or
+/// the lowest claim the hand has another card for, and plays the lowest card
+/// that could not be played honestly, so the honest cards stay in the hand.
+/// A swap gives such a card too and takes the card at a random index, the
+/// opponents hand is not seen
+///
+/// @param game game
+/// @param choice choice to fill
+/// @param random random number state
+///
+/// @return no return
+//
+void cfrChoices(EspGame* game, CfrChoice* choice, uint64_t* random)
+{
+  GameState* state = &game->state_;
+  Hand* hand = &state->players_[state->curr_player_ - 1].hand_;
+  Hand* opponent = &state->players_[2 - state->curr_player_].hand_;
+  MoveMask mask;
+  esp_legal_mask(game, &mask);
+  uint8_t legal = 0;
+  Move move = { MOVE_DRAW, 1, NO_CARD, NO_CARD, CHALLENGE_NONE, 0 };
+
+  if ((mask.bits_[0] & (1ull << ESP_INDEX_DRAW)) != 0)
+  {
+    choice->moves_[CFR_DRAW] = move;
+    legal |= 1u << CFR_DRAW;
+  }
+  if ((mask.bits_[0] & (3ull << ESP_INDEX_CHALLENGE)) != 0)
+  {
+    move.kind_ = MOVE_CHALLENGE;
+    move.parameters_ = 2;
+    move.challenge_ = CHALLENGE_SPICE;
+    choice->moves_[CFR_CHALLENGE_SPICE] = move;
+    move.challenge_ = CHALLENGE_VALUE;
+    choice->moves_[CFR_CHALLENGE_VALUE] = move;
+    legal |= (1u << CFR_CHALLENGE_SPICE) | (1u << CFR_CHALLENGE_VALUE);
+    move.challenge_ = CHALLENGE_NONE;
+  }
+
+  // every card of the hand may be played as the same claims
+  uint32_t present = handPresent(hand);
+  uint32_t claims = (present != 0) ? maskRow(&mask, ESP_INDEX_PLAY + __builtin_ctz(present) * CARD_KINDS) : 0;
+  uint32_t dishonest = present & ~claims;
+  move.parameters_ = 3;
+  if ((claims & present) != 0)
+  {
+    move.kind_ = MOVE_PLAY;
+    move.real_card_ = move.played_card_ = (Card)__builtin_ctz(claims & present);
+    choice->moves_[CFR_HONEST] = move;
+    legal |= 1u << CFR_HONEST;
+  }
+  for (uint32_t bluffs = ((claims & ~present) != 0) ? claims & ~present : claims; bluffs != 0; bluffs &= bluffs - 1)
+  {
+    Card claim = (Card)__builtin_ctz(bluffs);
+    uint32_t others = present & ~(1u << claim);
+    if (others == 0)
+      continue;
+    move.kind_ = MOVE_PLAY;
+    move.real_card_ = (Card)__builtin_ctz(((others & dishonest) != 0) ? others & dishonest : others);
+    move.played_card_ = claim;
+    choice->moves_[CFR_BLUFF] = move;
+    legal |= 1u << CFR_BLUFF;
+    break;
+  }
+
+  if (present != 0 && maskRow(&mask, ESP_INDEX_SWAP + __builtin_ctz(present) * CARD_KINDS) != 0)
+  {
+    move.kind_ = MOVE_SWAP;
+    move.real_card_ = (Card)__builtin_ctz((dishonest != 0) ? dishonest : present);
+    move.played_card_ = NO_CARD;
+    move.swap_index_ = (int)(nextRandom(random) % (uint64_t)handSize(opponent));
+    choice->moves_[CFR_SWAP] = move;
+    legal |= 1u << CFR_SWAP;
+  }
+
+  choice->legal_ = legal;
+  choice->infoset_ = cfrInfoset(game, legal);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Current strategy of a choice by regret matching: legal actions in
+/// proportion to their positive regrets, all legal actions alike when none
+/// has any
+///
+/// @param tables shared regrets
+/// @param choice state and legal actions
+/// @param strategy probabilities of the actions to fill
+///
+/// @return no return
+//
+void cfrStrategy(CfrTables* tables, CfrChoice* choice, double strategy[CFR_ACTIONS])
+{
+  size_t row = (size_t)choice->infoset_ * CFR_ACTIONS;
+  double total = 0;
+  int legal_count = 0;
+  for (int action = 0; action < CFR_ACTIONS; action++)
+  {
+    strategy[action] = 0;
+    if ((choice->legal_ & (1u << action)) == 0)
+      continue;
+    int64_t regret = atomic_load_explicit(&tables->regrets_[row + action], memory_order_relaxed);
+    strategy[action] = (regret > 0) ? (double)regret : 0;
+    total += strategy[action];
+    legal_count++;
+  }
+
+  for (int action = 0; action < CFR_ACTIONS; action++)
+  {
+    if ((choice->legal_ & (1u << action)) != 0)
+      strategy[action] = (total > 0) ? strategy[action] / total : 1.0 / legal_count;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Drawing an action from a strategy
+///
+/// @param strategy probabilities of the actions, summing up to 1
+/// @param random random number state
+///
+/// @return action
+//
+int sampleAction(double strategy[CFR_ACTIONS], uint64_t* random)
+{
+  double roll = (double)(nextRandom(random) >> 11) * 0x1.0p-53;
+  int last = 0;
+  for (int action = 0; action < CFR_ACTIONS; action++)
+  {
+    if (strategy[action] <= 0)
+      continue;
+    last = action;
+    roll -= strategy[action];
+    if (roll < 0)
+      return action;
+  }
+  return last;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Writing the average strategy as a table of CFR_ACTIONS probabilities out
+/// of 255 per information set after a 16-byte header: "ESPC", version,
+/// information sets and actions, little-endian. Unvisited information sets
+/// are all 0, the bot plays them uniformly
+///
+/// @param file_name table file, overwritten
+/// @param tables strategy sums
+///
+/// @return 1 = file not written; 0 = Valid
+//
+int writeCfrTable(char* file_name, CfrTables* tables)
+{
+  FILE* file = fopen(file_name, "wb");
+  if (file == NULL)
+    return 1;
+
+  uint32_t header[4] = { 0, htole32(CFR_VERSION), htole32(CFR_INFOSETS), htole32(CFR_ACTIONS) };
+  memcpy(header, CFR_MAGIC, 4);
+  bool written = fwrite(header, 1, CFR_HEADER_SIZE, file) == CFR_HEADER_SIZE;
+
+  for (int infoset = 0; infoset < CFR_INFOSETS && written; infoset++)
+  {
+    uint64_t sums[CFR_ACTIONS];
+    uint64_t total = 0;
+    for (int action = 0; action < CFR_ACTIONS; action++)
+    {
+      sums[action] = atomic_load_explicit(&tables->strategy_[infoset * CFR_ACTIONS + action], memory_order_relaxed);
+      total += sums[action];
+    }
+
+    // rounded down, what is left goes to the most likely action
+    uint8_t row[CFR_ACTIONS] = { 0 };
+    if (total > 0)
+    {
+      int given = 0;
+      int largest = 0;
+      for (int action = 0; action < CFR_ACTIONS; action++)
+      {
+        row[action] = (uint8_t)((unsigned __int128)sums[action] * 255 / total);
+        given += row[action];
+        largest = (sums[action] > sums[largest]) ? action : largest;
+      }
+      row[largest] = (uint8_t)(row[largest] + 255 - given);
+    }
+    written = fwrite(row, 1, CFR_ACTIONS, file) == CFR_ACTIONS;
+  }
+
+  return (fclose(file) == 0 && written) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Mapping a strategy table for a bot
+///
+/// @param bot bot to initialise
+/// @param file_name table written by --train-cfr
+/// @param seed seed of the action samples
+///
+/// @return 2 = file not open; 3 = not a valid table; 0 = Valid
+//
+int openCfrBot(CfrBot* bot, char* file_name, uint64_t seed)
+{
+  int file = open(file_name, O_RDONLY);
+  if (file < 0)
+    return CANT_OPEN_FILE;
+
+  struct stat info;
+  size_t length = (size_t)CFR_HEADER_SIZE + (size_t)CFR_INFOSETS * CFR_ACTIONS;
+  if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode) || (size_t)info.st_size != length)
+  {
+    close(file);
+    return INVALID_FILE;
+  }
+  uint8_t* bytes = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (bytes == MAP_FAILED)
+    return INVALID_FILE;
+
+  uint32_t header[4];
+  memcpy(header, bytes, CFR_HEADER_SIZE);
+  if (memcmp(bytes, CFR_MAGIC, 4) != 0 || le32toh(header[1]) != CFR_VERSION ||
+      le32toh(header[2]) != CFR_INFOSETS || le32toh(header[3]) != CFR_ACTIONS)
+  {
+    munmap(bytes, length);
+    return INVALID_FILE;
+  }
+
+  bot->table_ = bytes + CFR_HEADER_SIZE;
+  bot->mapped_ = length;
+  bot->random_ = seed;
+  bot->moves_ = 0;
+  bot->seconds_ = 0;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Unmapping the table of a bot
+///
+/// @param bot bot
+///
+/// @return no return
+//
+void closeCfrBot(CfrBot* bot)
+{
+  munmap((void*)(bot->table_ - CFR_HEADER_SIZE), bot->mapped_);
+  bot->table_ = NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Move provider of the table bot: looks up the abstract state of its player
+/// and draws a legal action by the probabilities of the table
+///
+/// @param context CfrBot
+/// @param view state of the turn, the bot reads the game only for what its
+///        player can see
+/// @param line move line, written to the bots move buffer
+///
+/// @return 0 = Valid
+//
+int cfrMove(void* context, TurnView* view, char** line)
+{
+  CfrBot* bot = (CfrBot*)context;
+  *line = bot->move_;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  CfrChoice choice;
+  cfrChoices(view->game_, &choice, &bot->random_);
+  const uint8_t* row = bot->table_ + (size_t)choice.infoset_ * CFR_ACTIONS;
+  int total = 0;
+  for (int action = 0; action < CFR_ACTIONS; action++)
+    total += ((choice.legal_ & (1u << action)) != 0) ? row[action] : 0;
+
+  // unvisited states and states without weight on a legal action are played uniformly
+  int legal_count = __builtin_popcount(choice.legal_);
+  Move move = { MOVE_QUIT, 1, NO_CARD, NO_CARD, CHALLENGE_NONE, 0 };
+  if (legal_count > 0)
+  {
+    int roll = (int)(nextRandom(&bot->random_) % (uint64_t)((total > 0) ? total : legal_count));
+    for (int action = 0; action < CFR_ACTIONS; action++)
+    {
+      if ((choice.legal_ & (1u << action)) == 0)
+        continue;
+      roll -= (total > 0) ? row[action] : 1;
+      if (roll < 0)
+      {
+        move = choice.moves_[action];
+        break;
+      }
+    }
+  }
+  formatMove(&move, bot->move_);
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  bot->seconds_ += (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+  bot->moves_++;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Printing the moves and time per move of a bot
+///
+/// @param bot bot
+/// @param player seat of the bot, 1 or 2
+/// @param out stream to print to
+///
+/// @return no return
+//
+void reportCfrBot(CfrBot* bot, int player, FILE* out)
+{
+  fprintf(out, "Player %d (cfr): %lu moves, %.0f ns/move\n", player, bot->moves_,
+    (bot->moves_ > 0) ? bot->seconds_ * 1e9 / (double)bot->moves_ : 0.0);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Index of the abstract state of the player in turn
+///
+/// @param game game
+/// @param legal legal actions
+///
+/// @return information set, 0 to CFR_INFOSETS - 1
+//
+static int cfrInfoset(EspGame* game, uint8_t legal)
+{
+  GameState* state = &game->state_;
+  Hand* hand = &state->players_[state->curr_player_ - 1].hand_;
+  Hand* opponent = &state->players_[2 - state->curr_player_].hand_;
+  bool claimed = state->cards_played_ > 0;
+
+  int infoset = bucket(handSize(hand), HAND_LIMITS, CFR_HAND_BUCKETS);
+  infoset = infoset * CFR_OPPONENT_BUCKETS + bucket(handSize(opponent), OPPONENT_LIMITS, CFR_OPPONENT_BUCKETS);
+  infoset = infoset * CFR_CLAIM_VALUES + (claimed ? cardValue(state->latest_played_card_) : 0);
+  infoset = infoset * 2 + ((claimed && handCount(hand, state->latest_played_card_) > 0) ? 1 : 0);
+  infoset = infoset * 2 + (((legal & (1u << CFR_HONEST)) != 0) ? 1 : 0);
+  infoset = infoset * 2 + (((legal & (1u << CFR_CHALLENGE_SPICE)) != 0) ? 1 : 0);
+  infoset = infoset * CFR_PLAYED_BUCKETS + bucket(state->cards_played_, PLAYED_LIMITS, CFR_PLAYED_BUCKETS);
+  uint32_t pile = game->deck_size_ - state->pile_next_;
+  return infoset * CFR_PILE_BUCKETS + bucket((pile > INT32_MAX) ? INT32_MAX : (int)pile, PILE_LIMITS, CFR_PILE_BUCKETS);
+}
+
+//------------------------------------------------------------------------------
+///
+/// CARD_KINDS bits of a move mask, the moves of one card
+///
+/// @param mask legal move mask
+/// @param offset move index of the first bit
+///
+/// @return bit n = move index offset + n is legal
+//
+static uint32_t maskRow(MoveMask* mask, int offset)
+{
+  int word = offset / 64;
+  int shift = offset % 64;
+  uint64_t bits = mask->bits_[word] >> shift;
+  if (shift > 64 - CARD_KINDS)
+    bits |= mask->bits_[word + 1] << (64 - shift);
+  return (uint32_t)bits & ((1u << CARD_KINDS) - 1);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Bucket of a number
+///
+/// @param value number
+/// @param limits lowest value of every bucket but the first, ascending
+/// @param buckets number of buckets
+///
+/// @return bucket, 0 to buckets - 1
+//
+static int bucket(int value, const int* limits, int buckets)
+{
+  int found = 0;
+  while (found < buckets - 1 && value >= limits[found])
+    found++;
+  return found;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Value of a game for one player: 1 for a win, -1 for a loss and 0 for the
+/// same points. A game cut at CFR_TURNS_MAX counts as ended, the points decide
+///
+/// @param game game
+/// @param player player 1 or 2
+///
+/// @return -1, 0 or 1
+//
+static double gameValue(EspGame* game, int player)
+{
+  int scores[2];
+  esp_scores(game, scores);
+  int difference = scores[player - 1] - scores[2 - player];
+  return (difference > 0) - (difference < 0);
+}
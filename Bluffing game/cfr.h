@@ -0,0 +1,102 @@
+#ifndef CFR_H
+#define CFR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "main.h"
+
+#define CFR_MAGIC "ESPC"
+#define CFR_VERSION 1
+#define CFR_HEADER_SIZE 16
+#define CFR_SCALE 1000         // fixed point of regrets and strategy sums
+#define CFR_PLAYOUTS 1         // playouts valuing each action of a decision
+#define CFR_WEIGHT_MAX 1024    // weight of the strategies of the last iteration
+#define CFR_TURNS_MAX 400
+#define CFR_THREADS_MAX 64
+
+// abstract actions, the bot maps each of them to one legal move
+enum {
+  CFR_HONEST,          // play a card as what it is
+  CFR_BLUFF,           // play a card as another one, preferably one not in the hand
+  CFR_CHALLENGE_SPICE,
+  CFR_CHALLENGE_VALUE,
+  CFR_DRAW,
+  CFR_SWAP,
+  CFR_ACTIONS
+};
+
+// buckets of the abstract state a strategy is kept for
+#define CFR_HAND_BUCKETS 6      // own cards 0, 1, 2, 3-4, 5-7, 8+
+#define CFR_OPPONENT_BUCKETS 5  // opponent cards 0, 1, 2, 3-4, 5+
+#define CFR_CLAIM_VALUES 11     // value of the latest claim, 0 = round start
+#define CFR_PLAYED_BUCKETS 6    // cards played in round 0, 1, 2, 3, 4-5, 6+
+#define CFR_PILE_BUCKETS 5      // draw pile cards 0-3, 4-7, 8-15, 16-31, 32+
+#define CFR_INFOSETS (CFR_HAND_BUCKETS * CFR_OPPONENT_BUCKETS * CFR_CLAIM_VALUES * 2 * 2 * 2 * \
+  CFR_PLAYED_BUCKETS * CFR_PILE_BUCKETS)
+
+// the abstract state of the player in turn and a move for each legal action
+typedef struct _CfrChoice_
+{
+  int infoset_;
+  uint8_t legal_;              // bit n = action n is legal
+  Move moves_[CFR_ACTIONS];
+} CfrChoice;
+
+// regrets and strategy sums shared by all training threads, updated without locks
+typedef struct _CfrTables_
+{
+  _Atomic int64_t* regrets_;   // CFR_INFOSETS * CFR_ACTIONS, regret matching+ keeps them >= 0
+  _Atomic uint64_t* strategy_; // sums of the strategies played by the traversers
+} CfrTables;
+
+// one training thread with its own copy of the deck
+typedef struct _CfrTrainer_
+{
+  _Alignas(ARENA_ALIGN) int index_;
+  int threads_;
+  unsigned long iterations_;   // iterations of all threads, this one runs index_, index_ + threads_, ...
+  uint64_t seed_;
+  DrawPile* deck_;             // shared and read-only
+  Card* cards_;                // deck shuffled for the current iteration
+  CfrTables* tables_;
+  unsigned long evaluations_;
+} CfrTrainer;
+
+// bot playing the average strategy of a table mapped from its file
+typedef struct _CfrBot_
+{
+  const uint8_t* table_;       // CFR_INFOSETS * CFR_ACTIONS probabilities out of 255
+  size_t mapped_;              // bytes of the mapping, header included
+  uint64_t random_;
+  unsigned long moves_;
+  double seconds_;
+  char move_[BOT_MOVE_SIZE];
+} CfrBot;
+
+int trainCfr(char* config_name, char* table_name, unsigned long iterations, int threads, uint64_t seed);
+
+void *runCfrTrainer(void* argument);
+
+int cfrTraverse(CfrTrainer* trainer, EspGame* game, int traverser, uint64_t weight, uint64_t* random);
+
+double cfrPlayout(CfrTrainer* trainer, EspGame* game, int traverser, int turn, uint64_t* random);
+
+void cfrChoices(EspGame* game, CfrChoice* choice, uint64_t* random);
+
+void cfrStrategy(CfrTables* tables, CfrChoice* choice, double strategy[CFR_ACTIONS]);
+
+int sampleAction(double strategy[CFR_ACTIONS], uint64_t* random);
+
+int writeCfrTable(char* file_name, CfrTables* tables);
+
+int openCfrBot(CfrBot* bot, char* file_name, uint64_t seed);
+
+void closeCfrBot(CfrBot* bot);
+
+int cfrMove(void* context, TurnView* view, char** line);
+
+void reportCfrBot(CfrBot* bot, int player, FILE* out);
+
+#endif // CFR_H
@@ -0,0 +1,957 @@
+#define _GNU_SOURCE // memrchr
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "deck.h"
+
+// spice index * CARD_VALUES + 1 of a spice letter, 0 = no spice
+static const uint8_t SPICE_OFFSETS[256] = { ['c'] = 1, ['p'] = CARD_VALUES + 1, ['w'] = 2 * CARD_VALUES + 1 };
+
+static bool isDeckEnd(const char* line, size_t length);
+static char* readAll(int file, size_t* length);
+static size_t headerLength(const char* text, size_t length, bool eof);
+static int stageTextCards(TextSource* text);
+
+//------------------------------------------------------------------------------
+///
+/// Extracting the cards of a config file into one contiguous buffer. The file
+/// is mapped into memory and large files are parsed on several threads.
+/// Binary decks are checked and played straight from the mapping
+///
+/// @param file_name config file, text or binary
+/// @param threads number of threads to parse with; 0 = by the size of the file
+/// @param draw_pile empty draw pile to fill
+/// @param error_line line of the first invalid entry when the file is invalid,
+///        0 for binary decks
+///
+/// @return 1 = file not open; 2 = not a valid file or a card out of range;
+///         3 = alloc fail; 0 = Valid
+//
+int extractCardsFromFile(char* file_name, int threads, DrawPile* draw_pile, size_t* error_line)
+{
+  int file = open(file_name, O_RDONLY);
+  if (file < 0)
+  {
+    return 1; // FILE NOT ABLE TO BE OPENED [ 1 ]
+  }
+
+  struct stat info;
+  if (fstat(file, &info) != 0)
+  {
+    close(file);
+    return 1;
+  }
+
+  size_t length = (size_t)info.st_size;
+  if (S_ISREG(info.st_mode) && length == 0)
+  {
+    close(file);
+    *error_line = 1;
+    return 2; // NOT A VALID FILE (Not ESP first)
+  }
+
+  // pipes and other files that cannot be mapped are read instead
+  char* text = S_ISREG(info.st_mode) ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+  bool mapped = text != MAP_FAILED;
+  if (mapped)
+    madvise(text, length, MADV_SEQUENTIAL);
+  else
+    text = readAll(file, &length);
+  close(file);
+  if (text == NULL)
+    return 3; // failed allocation [ 3 ]
+
+  if (length >= 4 && memcmp(text, DECK_MAGIC, 4) == 0)
+  {
+    *error_line = 0;
+    if (checkBinaryDeck(text, length) != 0)
+    {
+      if (mapped)
+        munmap(text, length);
+      else
+        free(text);
+      return 2; // NOT A VALID FILE (damaged binary deck)
+    }
+
+    draw_pile->size_ = length - DECK_HEADER_SIZE;
+    draw_pile->next_ = 0;
+    if (mapped)
+    {
+      draw_pile->cards_ = (Card*)text + DECK_HEADER_SIZE;
+      draw_pile->mapped_ = length;
+      return 0;
+    }
+    memmove(text, text + DECK_HEADER_SIZE, draw_pile->size_);
+    draw_pile->cards_ = (Card*)text;
+    draw_pile->mapped_ = 0;
+    return 0;
+  }
+
+  if (threads <= 0)
+    threads = loadThreads(length);
+  int extraction_check = extractCards(text, length, threads, draw_pile, error_line);
+
+  if (mapped)
+    munmap(text, length);
+  else
+    free(text);
+  return extraction_check;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Parsing a config file in memory. The file starts with the line ESP, followed
+/// by one card <value>_<spice> per line, LF or CRLF. The deck ends with the
+/// file, an empty line or the results the game appends ("Player ..."). The
+/// text is split at line starts into one chunk per thread
+///
+/// @param text content of the config file
+/// @param length bytes of the content
+/// @param threads number of threads to parse with
+/// @param draw_pile empty draw pile to fill
+/// @param error_line line of the first invalid entry, counted from 1
+///
+/// @return 2 = not a valid file or a card out of range; 3 = alloc fail; 0 = Valid
+//
+int extractCards(const char* text, size_t length, int threads, DrawPile* draw_pile, size_t* error_line)
+{
+  size_t header = headerLength(text, length, true);
+  if (header == 0)
+  {
+    *error_line = 1;
+    return 2; // NOT A VALID FILE (Not ESP first)
+  }
+
+  const char* body = text + header;
+  const char* end = text + length;
+  if (threads < 1)
+    threads = 1;
+  if (threads > LOAD_THREADS_MAX)
+    threads = LOAD_THREADS_MAX;
+
+  // every line of a card takes at least 4 bytes, "1_c\n"
+  DeckChunk chunks[LOAD_THREADS_MAX];
+  size_t capacity = 0;
+  const char* begin = body;
+  for (int i = 0; i < threads; i++)
+  {
+    const char* split = end;
+    if (i + 1 < threads)
+    {
+      split = body + (size_t)(end - body) * (size_t)(i + 1) / (size_t)threads;
+      if (split < begin)
+        split = begin;
+      const char* newline = memchr(split, '\n', (size_t)(end - split));
+      split = (newline == NULL) ? end : newline + 1;
+    }
+    chunks[i].begin_ = begin;
+    chunks[i].end_ = split;
+    chunks[i].count_ = 0;
+    chunks[i].lines_ = 0;
+    chunks[i].status_ = 0;
+    capacity += (size_t)(split - begin) / 4 + 1;
+    begin = split;
+  }
+
+  Card* cards = (Card*)malloc(capacity);
+  if (cards == NULL)
+    return 3; // failed allocation [ 3 ]
+
+  Card* room = cards;
+  for (int i = 0; i < threads; i++)
+  {
+    chunks[i].cards_ = room;
+    room += (size_t)(chunks[i].end_ - chunks[i].begin_) / 4 + 1;
+  }
+
+  pthread_t workers[LOAD_THREADS_MAX];
+  bool started[LOAD_THREADS_MAX] = { false };
+  for (int i = 1; i < threads; i++)
+    started[i] = pthread_create(&workers[i], NULL, parseChunk, &chunks[i]) == 0;
+  parseChunk(&chunks[0]);
+  for (int i = 1; i < threads; i++)
+  {
+    if (started[i])
+      pthread_join(workers[i], NULL);
+    else
+      parseChunk(&chunks[i]);
+  }
+
+  // chunks are moved together in order, up to the end of the deck
+  size_t count = 0;
+  size_t lines = 1; // the header
+  for (int i = 0; i < threads; i++)
+  {
+    if (chunks[i].status_ == 2)
+    {
+      free(cards);
+      *error_line = lines + chunks[i].lines_ + 1;
+      return 2; // NOT A VALID FILE (card out of range)
+    }
+    if (cards + count != chunks[i].cards_)
+      memmove(cards + count, chunks[i].cards_, chunks[i].count_);
+    count += chunks[i].count_;
+    lines += chunks[i].lines_;
+    if (chunks[i].status_ == 1)
+      break;
+  }
+
+  if (count > DECK_SIZE_MAX)
+  {
+    free(cards);
+    *error_line = (size_t)DECK_SIZE_MAX + 2;
+    return 2; // NOT A VALID FILE (too many cards)
+  }
+
+  Card* cards_temp = (Card*)realloc(cards, (count == 0) ? 1 : count);
+  draw_pile->cards_ = (cards_temp == NULL) ? cards : cards_temp;
+  draw_pile->size_ = count;
+  draw_pile->next_ = 0;
+  draw_pile->mapped_ = 0;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking a binary deck: magic, version, card count against the file size,
+/// the range of every card and the checksum
+///
+/// @param bytes content of the file
+/// @param length bytes of the content
+///
+/// @return 2 = not a valid binary deck; 0 = Valid
+//
+int checkBinaryDeck(const char* bytes, size_t length)
+{
+  uint32_t header[4];
+  if (length < DECK_HEADER_SIZE)
+    return 2;
+  memcpy(header, bytes, DECK_HEADER_SIZE);
+  if (memcmp(bytes, DECK_MAGIC, 4) != 0 || le32toh(header[1]) != DECK_VERSION ||
+      le32toh(header[2]) != length - DECK_HEADER_SIZE)
+    return 2;
+
+  const Card* cards = (const Card*)bytes + DECK_HEADER_SIZE;
+  uint32_t count = le32toh(header[2]);
+  Card largest = 0;
+  for (uint32_t i = 0; i < count; i++)
+    largest = (cards[i] > largest) ? cards[i] : largest;
+  if (largest >= CARD_KINDS || binaryChecksum(cards, count) != le32toh(header[3]))
+    return 2;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checksum of the cards of a binary deck. FNV-1a over 8 cards at a time in
+/// four independent lanes, so checking a deck of millions of cards takes a
+/// fraction of reading it
+///
+/// @param cards cards of the deck
+/// @param size number of cards
+///
+/// @return checksum
+//
+uint32_t binaryChecksum(const Card* cards, size_t size)
+{
+  uint64_t lanes[4] = { 0xCBF29CE484222325ULL, 0xCBF29CE484222325ULL ^ 1,
+    0xCBF29CE484222325ULL ^ 2, 0xCBF29CE484222325ULL ^ 3 };
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32)
+  {
+    for (int lane = 0; lane < 4; lane++)
+    {
+      uint64_t word;
+      memcpy(&word, cards + i + 8 * lane, sizeof(word));
+      lanes[lane] = (lanes[lane] ^ le64toh(word)) * 0x100000001B3ULL;
+    }
+  }
+
+  uint64_t hash = lanes[0] ^ (lanes[1] >> 1) ^ (lanes[2] >> 2) ^ (lanes[3] >> 3) ^ size;
+  for (; i < size; i++)
+    hash = (hash ^ cards[i]) * 0x100000001B3ULL;
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+//------------------------------------------------------------------------------
+///
+/// Format of a deck file, by its first bytes
+///
+/// @param file_name deck file
+///
+/// @return DECK_TEXT; DECK_BINARY; -1 = file not open
+//
+int deckFormat(char* file_name)
+{
+  int file = open(file_name, O_RDONLY);
+  if (file < 0)
+    return -1;
+
+  char magic[4];
+  ssize_t got = read(file, magic, sizeof(magic));
+  close(file);
+  return (got == 4 && memcmp(magic, DECK_MAGIC, 4) == 0) ? DECK_BINARY : DECK_TEXT;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Writing the cards of a draw pile as a config file, either as text with the
+/// ESP header and one card per line or as a binary deck
+///
+/// @param file_name file to write, overwritten
+/// @param draw_pile cards to write
+/// @param format DECK_TEXT or DECK_BINARY
+///
+/// @return 1 = file not written; 2 = too many cards; 0 = Valid
+//
+int writeDeck(char* file_name, DrawPile* draw_pile, int format)
+{
+  static const char CARD_LINES[CARD_KINDS][6] = {
+    "1_c\n", "2_c\n", "3_c\n", "4_c\n", "5_c\n", "6_c\n", "7_c\n", "8_c\n", "9_c\n", "10_c\n",
+    "1_p\n", "2_p\n", "3_p\n", "4_p\n", "5_p\n", "6_p\n", "7_p\n", "8_p\n", "9_p\n", "10_p\n",
+    "1_w\n", "2_w\n", "3_w\n", "4_w\n", "5_w\n", "6_w\n", "7_w\n", "8_w\n", "9_w\n", "10_w\n"
+  };
+
+  if (draw_pile->size_ > DECK_SIZE_MAX)
+    return 2;
+
+  FILE* file = fopen(file_name, "wb");
+  if (file == NULL)
+    return 1;
+
+  bool written = true;
+  if (format == DECK_BINARY)
+  {
+    uint32_t count = (uint32_t)draw_pile->size_;
+    uint32_t header[4] = { 0, htole32(DECK_VERSION), htole32(count),
+      htole32(binaryChecksum(draw_pile->cards_, count)) };
+    memcpy(header, DECK_MAGIC, 4);
+    written = fwrite(header, 1, DECK_HEADER_SIZE, file) == DECK_HEADER_SIZE &&
+      fwrite(draw_pile->cards_, 1, count, file) == count;
+  }
+  else
+  {
+    written = fputs("ESP\n", file) >= 0;
+    for (size_t i = 0; i < draw_pile->size_ && written; i++)
+    {
+      Card card = draw_pile->cards_[i];
+      written = card < CARD_KINDS && fputs(CARD_LINES[card], file) >= 0;
+    }
+  }
+
+  return (fclose(file) == 0 && written) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Counter-based random numbers: the number is a pure function of the seed,
+/// the game and the counter, so any game of any seed is dealt the same on every
+/// thread and machine without sharing generator state. SplitMix64 steps keyed
+/// by seed and game
+///
+/// @param seed seed of a run
+/// @param game index of the game in the run
+/// @param counter index of the number in the game
+///
+/// @return random number
+//
+uint64_t counterRandom(uint64_t seed, uint64_t game, uint64_t counter)
+{
+  uint64_t key = seed ^ (game + 1) * 0xD1B54A32D192ED03ULL;
+  key = (key ^ (key >> 32)) * 0xDABA0B6EB09322E3ULL;
+  key ^= key >> 29;
+
+  uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Shuffling cards with Fisher-Yates. The order only depends on the cards, the
+/// seed and the game, swap n takes its number from counterRandom
+///
+/// @param cards cards to shuffle
+/// @param size number of cards
+/// @param seed seed of a run
+/// @param game index of the game in the run
+///
+/// @return no return
+//
+void shuffleCards(Card* cards, size_t size, uint64_t seed, uint64_t game)
+{
+  for (size_t i = size; i > 1; i--)
+  {
+    size_t j = (size_t)(((unsigned __int128)counterRandom(seed, game, i) * i) >> 64);
+    Card card = cards[i - 1];
+    cards[i - 1] = cards[j];
+    cards[j] = card;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Parsing the composition of a deck: comma separated <card>=<count> entries
+/// like 8_p=12. Value or spice may be *, e.g. *_c=3 or 10_*=6, later entries
+/// override earlier ones. A card has at most HAND_COPIES_MAX copies, so no
+/// hand of a game on the deck can run out of room for one
+///
+/// @param spec composition
+/// @param counts copies of every card, all 0 unless given
+///
+/// @return 2 = invalid composition; 0 = Valid
+//
+int parseComposition(const char* spec, uint32_t counts[CARD_KINDS])
+{
+  memset(counts, 0, CARD_KINDS * sizeof(uint32_t));
+
+  while (*spec != '\0')
+  {
+    int low = 1;
+    int high = CARD_VALUES;
+    if (*spec != '*')
+    {
+      char* end = NULL;
+      long value = strtol(spec, &end, 10);
+      if (end == spec || value < 1 || value > CARD_VALUES)
+        return 2;
+      low = high = (int)value;
+      spec = end;
+    }
+    else
+      spec++;
+
+    if (*spec++ != '_' || *spec == '\0')
+      return 2;
+    const char* spices = (*spec == '*') ? "cpw" : spec;
+    size_t spice_count = (*spec == '*') ? 3 : 1;
+    spec++;
+
+    if (*spec++ != '=')
+      return 2;
+    char* end = NULL;
+    unsigned long count = strtoul(spec, &end, 10);
+    if (end == spec || count > HAND_COPIES_MAX)
+      return 2;
+    spec = end;
+
+    for (size_t spice = 0; spice < spice_count; spice++)
+    {
+      for (int value = low; value <= high; value++)
+      {
+        Card card = makeCard(value, spices[spice]);
+        if (card == NO_CARD)
+          return 2;
+        counts[card] = (uint32_t)count;
+      }
+    }
+
+    if (*spec == ',')
+      spec++;
+    else if (*spec != '\0')
+      return 2;
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Building an unshuffled deck of a composition, cards in ascending order
+///
+/// @param counts copies of every card
+/// @param draw_pile empty draw pile to fill
+///
+/// @return 2 = too many cards; 3 = alloc fail; 0 = Valid
+//
+int composeDeck(uint32_t counts[CARD_KINDS], DrawPile* draw_pile)
+{
+  uint64_t size = 0;
+  for (Card card = 0; card < CARD_KINDS; card++)
+    size += counts[card];
+  if (size > DECK_SIZE_MAX)
+    return 2;
+
+  Card* cards = (Card*)malloc((size == 0) ? 1 : (size_t)size);
+  if (cards == NULL)
+    return 3;
+
+  size_t next = 0;
+  for (Card card = 0; card < CARD_KINDS; card++)
+  {
+    memset(cards + next, card, counts[card]);
+    next += counts[card];
+  }
+
+  draw_pile->cards_ = cards;
+  draw_pile->size_ = (size_t)size;
+  draw_pile->next_ = 0;
+  draw_pile->mapped_ = 0;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Parsing the lines of a chunk into cards until the chunk, the deck or a
+/// valid card ends. Runs as a thread
+///
+/// @param chunk DeckChunk to parse
+///
+/// @return NULL
+//
+void* parseChunk(void* chunk)
+{
+  DeckChunk* piece = (DeckChunk*)chunk;
+  const char* line = piece->begin_;
+  const char* end = piece->end_;
+  Card* cards = piece->cards_;
+  size_t lines = 0;
+
+  while (line < end)
+  {
+    // a card line has at most 6 bytes, "10_c\r\n"; with 8 bytes left it is
+    // decoded from one word without branching on its form
+    if (end - line >= 8)
+    {
+      uint64_t word;
+      memcpy(&word, line, sizeof(word));
+      word = le64toh(word);
+      unsigned first = (unsigned)(word & 0xFF);
+      unsigned wide = ((word >> 8) & 0xFF) != '_';           // "10_"
+      uint64_t rest = word >> (wide * 8);                     // '_', spice, end of line
+      unsigned spice = SPICE_OFFSETS[(rest >> 16) & 0xFF];
+      unsigned carriage = ((rest >> 24) & 0xFF) == '\r';
+      bool valid = (first - '1' < 9) & (!wide | ((word & 0xFFFF) == 0x3031)) &
+        (((rest >> 8) & 0xFF) == '_') & (spice != 0) & (((rest >> (24 + carriage * 8)) & 0xFF) == '\n');
+      if (valid)
+      {
+        *cards++ = (Card)(spice - 1 + first - '1' + wide * 9);
+        lines++;
+        line += 4 + wide + carriage;
+        continue;
+      }
+    }
+
+    size_t length = (size_t)(end - line);
+    size_t at = 1;
+    int value = line[0] - '0';
+    if (length >= 4 && value == 1 && line[1] == '0')
+    {
+      value = 10;
+      at = 2;
+    }
+
+    int spice = -1;
+    if (length >= at + 2 && value >= 1 && value <= 9 + (at == 2) && line[at] == '_')
+    {
+      switch (line[at + 1])
+      {
+        case 'c':
+          spice = 0;
+          break;
+        case 'p':
+          spice = 1;
+          break;
+        case 'w':
+          spice = 2;
+          break;
+        default:
+          break;
+      }
+    }
+
+    at += 2;
+    if (spice >= 0 && at < length && line[at] == '\r')
+      at++;
+    if (spice < 0 || (at < length && line[at] != '\n'))
+    {
+      piece->status_ = isDeckEnd(line, length) ? 1 : 2;
+      break;
+    }
+
+    *cards++ = (Card)(spice * CARD_VALUES + value - 1);
+    lines++;
+    line += (at < length) ? at + 1 : at;
+  }
+
+  piece->count_ = (size_t)(cards - piece->cards_);
+  piece->lines_ = lines;
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Number of threads to parse a file with, one per processor, but only one
+/// for every LOAD_CHUNK_MIN bytes
+///
+/// @param length bytes of the file
+///
+/// @return number of threads
+//
+int loadThreads(size_t length)
+{
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t threads = length / LOAD_CHUNK_MIN + 1;
+
+  if (processors > 0 && threads > (size_t)processors)
+    threads = (size_t)processors;
+  if (threads > LOAD_THREADS_MAX)
+    threads = LOAD_THREADS_MAX;
+  return (int)threads;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Freeing the cards of a draw pile, binary decks are unmapped
+///
+/// @param draw_pile draw pile
+///
+/// @return no return
+//
+void freeCards(DrawPile* draw_pile)
+{
+  if (draw_pile->mapped_ != 0)
+    munmap(draw_pile->cards_ - DECK_HEADER_SIZE, draw_pile->mapped_);
+  else
+    free(draw_pile->cards_);
+  draw_pile->cards_ = NULL;
+  draw_pile->size_ = 0;
+  draw_pile->next_ = 0;
+  draw_pile->mapped_ = 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Initialising a streamed draw pile on a source, no cards are read yet
+///
+/// @param stream stream to initialise
+/// @param source where the cards come from
+///
+/// @return 3 = alloc fail; 0 = Valid
+//
+int initialisePileStream(PileStream* stream, CardSource* source)
+{
+  stream->source_ = *source;
+  stream->ring_ = (Card*)malloc(PILE_RING_SIZE);
+  stream->written_ = 0;
+  stream->ended_ = false;
+  return (stream->ring_ == NULL) ? 3 : 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Freeing the ring of a streamed draw pile, the source is not touched
+///
+/// @param stream stream
+///
+/// @return no return
+//
+void freePileStream(PileStream* stream)
+{
+  free(stream->ring_);
+  stream->ring_ = NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Putting new cards into the ring over the cards that have been drawn. The
+/// source is only read once fewer than ESP_DRAWS_MAX cards are left ahead, then
+/// the whole ring is filled
+///
+/// @param stream stream
+/// @param drawn cards of the deck drawn so far, modulo 2^32
+///
+/// @return 2 = invalid deck; 0 = Valid
+//
+int refillPileStream(PileStream* stream, uint32_t drawn)
+{
+  if (stream->ended_ || stream->written_ - drawn >= ESP_DRAWS_MAX)
+    return 0;
+
+  while (!stream->ended_ && stream->written_ - drawn < PILE_RING_SIZE)
+  {
+    size_t at = stream->written_ & (PILE_RING_SIZE - 1);
+    size_t room = PILE_RING_SIZE - (stream->written_ - drawn);
+    if (room > PILE_RING_SIZE - at)
+      room = PILE_RING_SIZE - at;
+
+    size_t count = 0;
+    if (stream->source_.read_(stream->source_.context_, stream->ring_ + at, room, &count) != 0)
+      return 2;
+    stream->written_ += (uint32_t)count;
+    stream->ended_ = count == 0;
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Starting the deck of a stream over for the next game
+///
+/// @param stream stream
+///
+/// @return 1 = the source cannot start over; 0 = Valid
+//
+int rewindPileStream(PileStream* stream)
+{
+  if (stream->source_.rewind_(stream->source_.context_) != 0)
+    return 1;
+  stream->written_ = 0;
+  stream->ended_ = false;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Opening a text config file as a card source. Nothing is parsed until the
+/// first cards are read, invalid lines are reported then
+///
+/// @param text source to initialise
+/// @param file_name config file, may be a pipe
+///
+/// @return 1 = file not open; 3 = alloc fail; 0 = Valid
+//
+int openTextSource(TextSource* text, char* file_name)
+{
+  text->buffer_ = (char*)malloc(STREAM_CHUNK);
+  text->staged_ = (Card*)malloc(STREAM_CHUNK / 4 + 1);
+  if (text->buffer_ == NULL || text->staged_ == NULL)
+  {
+    free(text->buffer_);
+    free(text->staged_);
+    return 3;
+  }
+
+  text->fd_ = open(file_name, O_RDONLY);
+  if (text->fd_ < 0)
+  {
+    free(text->buffer_);
+    free(text->staged_);
+    return 1;
+  }
+  rewindTextCards(text);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Closing a text card source
+///
+/// @param text source
+///
+/// @return no return
+//
+void closeTextSource(TextSource* text)
+{
+  close(text->fd_);
+  free(text->buffer_);
+  free(text->staged_);
+  text->buffer_ = NULL;
+  text->staged_ = NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Card source of a text config file, see CardSource. The line of an invalid
+/// entry is line_ + 1
+///
+/// @param context TextSource
+/// @param cards room for the cards
+/// @param capacity number of cards to read at most
+/// @param count cards read; 0 = end of the deck
+///
+/// @return 2 = invalid line; 0 = Valid
+//
+int readTextCards(void* context, Card* cards, size_t capacity, size_t* count)
+{
+  TextSource* text = (TextSource*)context;
+  *count = 0;
+
+  while (*count < capacity)
+  {
+    size_t staged = text->staged_count_ - text->staged_next_;
+    if (staged > 0)
+    {
+      if (staged > capacity - *count)
+        staged = capacity - *count;
+      memcpy(cards + *count, text->staged_ + text->staged_next_, staged);
+      text->staged_next_ += staged;
+      *count += staged;
+    }
+    else if (text->ended_)
+      break;
+    else if (stageTextCards(text) != 0)
+      return 2;
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Starting a text card source over at the start of the file
+///
+/// @param context TextSource
+///
+/// @return 1 = the file cannot be read again, e.g. a pipe; 0 = Valid
+//
+int rewindTextCards(void* context)
+{
+  TextSource* text = (TextSource*)context;
+  if (lseek(text->fd_, 0, SEEK_SET) != 0)
+    return 1;
+
+  text->start_ = 0;
+  text->end_ = 0;
+  text->staged_count_ = 0;
+  text->staged_next_ = 0;
+  text->line_ = 0;
+  text->header_ = false;
+  text->eof_ = false;
+  text->ended_ = false;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if a line that is no card ends the deck: an empty line or the
+/// results of a game appended to the file
+///
+/// @param line start of the line
+/// @param length bytes left in the file from the line on
+///
+/// @return false = invalid line; true = end of the deck
+//
+static bool isDeckEnd(const char* line, size_t length)
+{
+  if (line[0] == '\n' || (length >= 2 && line[0] == '\r' && line[1] == '\n'))
+    return true;
+  return length >= 7 && memcmp(line, "Player ", 7) == 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Reading a file that cannot be mapped into memory
+///
+/// @param file open file
+/// @param length bytes read
+///
+/// @return content of the file; NULL = Mem error
+//
+static char* readAll(int file, size_t* length)
+{
+  size_t capacity = 1 << 16;
+  size_t size = 0;
+  char* text = (char*)malloc(capacity);
+
+  while (text != NULL)
+  {
+    if (size == capacity)
+    {
+      capacity *= 2;
+      char* text_temp = (char*)realloc(text, capacity);
+      if (text_temp == NULL)
+        break;
+      text = text_temp;
+    }
+    ssize_t got = read(file, text + size, capacity - size);
+    if (got <= 0)
+    {
+      *length = size;
+      return text;
+    }
+    size += (size_t)got;
+  }
+
+  free(text);
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Length of the ESP header line at the start of a config file
+///
+/// @param text start of the file
+/// @param length bytes of the file known so far
+/// @param eof true = the file ends after length bytes
+///
+/// @return bytes of the header with its line end; 0 = no header
+//
+static size_t headerLength(const char* text, size_t length, bool eof)
+{
+  if (length >= 4 && memcmp(text, "ESP\n", 4) == 0)
+    return 4;
+  if (length >= 5 && memcmp(text, "ESP\r\n", 5) == 0)
+    return 5;
+  if (eof && length == 3 && memcmp(text, "ESP", 3) == 0)
+    return 3;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Reading the next piece of a text card source and parsing its complete lines
+/// into the staged cards. Reads until at least one line is complete
+///
+/// @param text source, the staged cards are all handed out
+///
+/// @return 2 = invalid line; 0 = Valid
+//
+static int stageTextCards(TextSource* text)
+{
+  text->staged_count_ = 0;
+  text->staged_next_ = 0;
+
+  while (true)
+  {
+    char* begin = text->buffer_ + text->start_;
+    size_t pending = text->end_ - text->start_;
+    if (!text->header_ && (pending >= 5 || text->eof_))
+    {
+      size_t header = headerLength(begin, pending, text->eof_);
+      if (header == 0)
+        return 2; // NOT A VALID FILE (Not ESP first), line 1
+      text->start_ += header;
+      text->line_ = 1;
+      text->header_ = true;
+      continue;
+    }
+
+    const char* newline = (text->header_ && pending > 0) ? memrchr(begin, '\n', pending) : NULL;
+    if (newline != NULL || (text->eof_ && text->header_))
+    {
+      const char* end = text->eof_ ? begin + pending : newline + 1;
+      DeckChunk chunk = { begin, end, text->staged_, 0, 0, 0 };
+      parseChunk(&chunk);
+      text->staged_count_ = chunk.count_;
+      text->line_ += chunk.lines_;
+      text->start_ += (size_t)(end - begin);
+      if (chunk.status_ == 2)
+        return 2;
+      text->ended_ = chunk.status_ == 1 || text->eof_;
+      return 0;
+    }
+    if (pending == STREAM_CHUNK)
+      return 2; // line longer than a chunk, no card
+
+    memmove(text->buffer_, begin, pending);
+    text->start_ = 0;
+    text->end_ = pending;
+    ssize_t got = read(text->fd_, text->buffer_ + text->end_, STREAM_CHUNK - text->end_);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      text->eof_ = true;
+    else
+      text->end_ += (size_t)got;
+  }
+}
@@ -0,0 +1,117 @@
+#ifndef DECK_H
+#define DECK_H
+
+#include <stddef.h>
+
+#include "esp.h"
+
+// files below this size are parsed on one thread
+#define LOAD_CHUNK_MIN (4 << 20)
+#define LOAD_THREADS_MAX 64
+
+// binary deck: "ESPD", version, card count and binaryChecksum of the cards as
+// little-endian 32-bit numbers, then one byte per card in draw order
+#define DECK_MAGIC "ESPD"
+#define DECK_VERSION 1
+#define DECK_HEADER_SIZE 16
+
+enum {
+  DECK_TEXT,
+  DECK_BINARY
+};
+
+// streamed draw piles: bytes of the file read at a time and cards in the ring,
+// a power of two
+#define STREAM_CHUNK 65536
+#define PILE_RING_SIZE 65536
+
+// one piece of a config file, parsed by one thread
+typedef struct _DeckChunk_
+{
+  const char* begin_; // first byte, always the start of a line
+  const char* end_;
+  Card* cards_;       // room for every line of the chunk
+  size_t count_;      // cards parsed
+  size_t lines_;      // lines parsed; the line that stopped the chunk otherwise
+  int status_;        // 0 = all lines are cards; 1 = end of the deck; 2 = invalid line
+} DeckChunk;
+
+// where a streamed draw pile gets its cards from. read_ puts up to capacity
+// cards into cards and returns 0 with *count = 0 at the end of the deck, 2 for
+// an invalid deck. rewind_ starts the deck over, 1 = not possible
+typedef struct _CardSource_
+{
+  int (*read_)(void* context, Card* cards, size_t capacity, size_t* count);
+  int (*rewind_)(void* context);
+  void* context_;
+} CardSource;
+
+// the cards of a text config file, read a chunk at a time
+typedef struct _TextSource_
+{
+  int fd_;
+  char* buffer_;        // STREAM_CHUNK bytes of the file
+  size_t start_;        // first byte not parsed yet
+  size_t end_;          // one past the last byte read
+  Card* staged_;        // cards parsed from the buffer, STREAM_CHUNK / 4 + 1
+  size_t staged_count_;
+  size_t staged_next_;  // first staged card not handed out yet
+  size_t line_;         // lines parsed so far, the header included
+  bool header_;         // the ESP header has been read
+  bool eof_;
+  bool ended_;          // the deck has ended, nothing more is parsed
+} TextSource;
+
+// a draw pile of constant size for decks of any length. Card n of the deck is
+// ring_[n % PILE_RING_SIZE], drawn cards are overwritten by new ones
+typedef struct _PileStream_
+{
+  CardSource source_;
+  Card* ring_;          // PILE_RING_SIZE cards
+  uint32_t written_;    // cards of the deck put into the ring so far, modulo 2^32
+  bool ended_;          // the source has no more cards
+} PileStream;
+
+int extractCardsFromFile(char* file_name, int threads, DrawPile* draw_pile, size_t* error_line);
+
+int extractCards(const char* text, size_t length, int threads, DrawPile* draw_pile, size_t* error_line);
+
+int checkBinaryDeck(const char* bytes, size_t length);
+
+uint32_t binaryChecksum(const Card* cards, size_t size);
+
+int deckFormat(char* file_name);
+
+int writeDeck(char* file_name, DrawPile* draw_pile, int format);
+
+uint64_t counterRandom(uint64_t seed, uint64_t game, uint64_t counter);
+
+void shuffleCards(Card* cards, size_t size, uint64_t seed, uint64_t game);
+
+int parseComposition(const char* spec, uint32_t counts[CARD_KINDS]);
+
+int composeDeck(uint32_t counts[CARD_KINDS], DrawPile* draw_pile);
+
+void* parseChunk(void* chunk);
+
+int loadThreads(size_t length);
+
+void freeCards(DrawPile* draw_pile);
+
+int initialisePileStream(PileStream* stream, CardSource* source);
+
+void freePileStream(PileStream* stream);
+
+int refillPileStream(PileStream* stream, uint32_t drawn);
+
+int rewindPileStream(PileStream* stream);
+
+int openTextSource(TextSource* text, char* file_name);
+
+void closeTextSource(TextSource* text);
+
+int readTextCards(void* context, Card* cards, size_t capacity, size_t* count);
+
+int rewindTextCards(void* context);
+
+#endif // DECK_H
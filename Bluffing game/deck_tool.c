@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "deck.h"
+
+#define DECK_USAGE "Usage: ./esp-deck compile <config file> <binary deck>\n" \
+  "       ./esp-deck decompile <binary deck> <config file>\n"
+
+//------------------------------------------------------------------------------
+///
+/// Converting decks between the text config format and the binary format.
+/// Both commands read either format, compile writes a binary deck and
+/// decompile a text config file
+///
+/// @param argc program name
+/// @param argv command, input file and output file
+///
+/// @return 1 = wrong usage; 2 = file not open; 3 = not a valid file;
+///         4 = alloc fail; 0 = End
+//
+int main(int argc, char* argv[])
+{
+  if (argc != 4 || (strcmp(argv[1], "compile") != 0 && strcmp(argv[1], "decompile") != 0))
+  {
+    printf("%s", DECK_USAGE);
+    return WRONG_USAGE;
+  }
+
+  DrawPile deck = { NULL, 0, 0, 0 };
+  size_t error_line = 0;
+  int extraction_check = extractCardsFromFile(argv[2], 0, &deck, &error_line);
+  if (extraction_check == 1)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    return CANT_OPEN_FILE;
+  }
+  else if (extraction_check == 2)
+  {
+    if (error_line == 0)
+      printf("Error: Invalid file: %s\n", argv[2]);
+    else
+      printf("Error: Invalid file: %s (line %zu)\n", argv[2], error_line);
+    return INVALID_FILE;
+  }
+  else if (extraction_check == 3)
+  {
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  int format = (strcmp(argv[1], "compile") == 0) ? DECK_BINARY : DECK_TEXT;
+  int write_check = writeDeck(argv[3], &deck, format);
+  freeCards(&deck);
+  if (write_check != 0)
+  {
+    printf("Error: Cannot open file: %s\n", argv[3]);
+    return CANT_OPEN_FILE;
+  }
+  return GAME_END;
+}
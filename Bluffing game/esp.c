@@ -0,0 +1,1724 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp.h"
+
+static void startRound(EspGame* game);
+static void distributeCardsToPlayers(EspGame* game);
+static void movePlay(EspGame* game, Move* move);
+static int Draw(EspGame* game);
+static void moveChallenge(EspGame* game, Move* move, EspOutcome* outcome);
+static int awardChallenge(EspGame* game, bool challenge_successful, EspOutcome* outcome);
+static int endRound(EspGame* game, int loser);
+static void moveSwap(EspGame* game, Move* move, EspUndo* undo);
+static void unmakeDraws(EspGame* game, EspUndo* undo);
+static Card deleteWhenIndex(Player* curr_p, int index);
+static int drawTwoCards(EspGame* game, Player* p);
+static int drawSixCards(EspGame* game, Player* p);
+static bool isGamePileEmpty(EspGame* game);
+static int addDrawedCard(EspGame* game, Player* p);
+static int isValidMove(EspGame* game, Move* move);
+static uint8_t allowedCommands(EspGame* game);
+#ifdef ESP_VERIFY_RULES
+static int referenceValidMove(EspGame* game, Move* move);
+static Card referenceHandNth(Hand* hand, int index);
+static bool isValidSwap(EspGame* game, Move* move);
+static bool isParameterValid(Move* move);
+static bool isCommandValid(Move* move);
+static bool isCommandTimedRight(EspGame* game, Move* move);
+static bool isFormatValid(Move* move);
+static bool isInHand(Move* move, Player* p);
+static int isValidCurrentPlay(EspGame* game, Move* move);
+static bool isValidChallengeType(Move* move);
+#endif
+static bool canChallenge(EspGame* game);
+static uint32_t allowedClaims(EspGame* game);
+static void moveFromIndex(int index, Move* move);
+static void maskSetBits(MoveMask* mask, int offset, uint32_t bits);
+static uint32_t pairSums(uint32_t counts);
+static uint32_t deckChecksum(Card* cards, uint32_t size);
+static void writeWord(uint8_t* bytes, uint32_t word);
+static uint32_t readWord(uint8_t* bytes);
+
+#define ALWAYS (1 << MOVE_QUIT | 1 << MOVE_SWAP)
+#define CARDS (1 << MOVE_PLAY | 1 << MOVE_DRAW)
+#define CHALLENGE (1 << MOVE_CHALLENGE)
+
+// commands allowed by the last action (0 = play, 1 = draw, 2 = unused,
+// 3 = challenge), by the round (no card played yet, cards played) and by the
+// opponent (has cards, has no cards). Play and draw need cards at the
+// opponent, a challenge needs a played card that was not followed by a draw
+static const uint8_t COMMAND_TIMING[4][2][2] = {
+  { { ALWAYS | CARDS, ALWAYS }, { ALWAYS | CARDS | CHALLENGE, ALWAYS | CHALLENGE } },
+  { { ALWAYS | CARDS, ALWAYS }, { ALWAYS | CARDS, ALWAYS } },
+  { { ALWAYS | CARDS, ALWAYS }, { ALWAYS | CARDS, ALWAYS } },
+  { { ALWAYS | CARDS, ALWAYS }, { ALWAYS | CARDS | CHALLENGE, ALWAYS | CHALLENGE } }
+};
+
+#undef ALWAYS
+#undef CARDS
+#undef CHALLENGE
+
+// values that may be claimed after the latest claimed value, bit n = value
+// n + 1. 0 = start of the round, after a 10 the values start over at 1 to 3
+static const uint16_t CLAIM_VALUES[CARD_VALUES + 1] = {
+  0x007, 0x3FE, 0x3FC, 0x3F8, 0x3F0, 0x3E0, 0x3C0, 0x380, 0x300, 0x200, 0x007
+};
+
+// fewest and most words a move is given with, by MOVE_*
+static const uint8_t PARAMETER_COUNTS[MOVE_QUIT + 1][2] = { { 0, 0 }, { 3, 3 }, { 0, 1 }, { 2, 2 }, { 3, 3 }, { 0, 1 } };
+
+//------------------------------------------------------------------------------
+///
+/// Checking if all cards of the draw pile have been drawn
+///
+/// @param draw_pile draw pile
+///
+/// @return false = cards left; true = empty
+//
+bool isPileEmpty(DrawPile* draw_pile)
+{
+  return draw_pile->next_ >= draw_pile->size_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Packing a card into one byte
+///
+/// @param value value of the card (1-10)
+/// @param spice spice of the card (c, p, w)
+///
+/// @return packed card; NO_CARD = value or spice out of range
+//
+Card makeCard(int value, char spice)
+{
+  if (value < 1 || value > CARD_VALUES)
+    return NO_CARD;
+
+  switch (spice)
+  {
+    case 'c':
+      return (Card)(value - 1);
+    case 'p':
+      return (Card)(CARD_VALUES + value - 1);
+    case 'w':
+      return (Card)(2 * CARD_VALUES + value - 1);
+    default:
+      return NO_CARD;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Value of a packed card
+///
+/// @param card packed card
+///
+/// @return value (1-10)
+//
+int cardValue(Card card)
+{
+  return card % CARD_VALUES + 1;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Spice of a packed card
+///
+/// @param card packed card
+///
+/// @return spice (c, p, w)
+//
+char cardSpice(Card card)
+{
+  return "cpw"[card / CARD_VALUES];
+}
+
+//------------------------------------------------------------------------------
+///
+/// Number of copies of a card in a hand
+///
+/// @param hand hand
+/// @param card packed card
+///
+/// @return copies of the card (0-31)
+//
+int handCount(Hand* hand, Card card)
+{
+  return (hand->counts_[card / HAND_WORD_CARDS] >> ((card % HAND_WORD_CARDS) * 5)) & 0x1F;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Adding a card to a hand. The hand stays ordered by (spice, value) since the
+/// cards are kept by their packed id
+///
+/// @param hand hand
+/// @param card packed card
+///
+/// @return false = already HAND_COPIES_MAX copies in hand; true = added
+//
+bool handAdd(Hand* hand, Card card)
+{
+  if (handCount(hand, card) == HAND_COPIES_MAX)
+    return false;
+
+  hand->counts_[card / HAND_WORD_CARDS] += 1u << ((card % HAND_WORD_CARDS) * 5);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Removing one copy of a card from a hand
+///
+/// @param hand hand
+/// @param card packed card
+///
+/// @return false = card not in hand; true = removed
+//
+bool handRemove(Hand* hand, Card card)
+{
+  if (card == NO_CARD || handCount(hand, card) == 0)
+    return false;
+
+  hand->counts_[card / HAND_WORD_CARDS] -= 1u << ((card % HAND_WORD_CARDS) * 5);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if a hand has no cards left
+///
+/// @param hand hand
+///
+/// @return false = cards in hand; true = empty
+//
+bool handIsEmpty(Hand* hand)
+{
+  return (hand->counts_[0] | hand->counts_[1] | hand->counts_[2] | hand->counts_[3] | hand->counts_[4]) == 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Cards of a hand as a bitset. Each word folds its six 5-bit counters into
+/// their lowest bits, then moves those bits together in three shifts
+///
+/// @param hand hand
+///
+/// @return bit n set while card n is in the hand
+//
+uint32_t handPresent(Hand* hand)
+{
+  uint32_t present = 0;
+
+  for (int word = 0; word < HAND_WORDS; word++)
+  {
+    uint32_t counts = hand->counts_[word];
+    uint32_t bits = (counts | counts >> 1 | counts >> 2 | counts >> 3 | counts >> 4) & 0x02108421u; // bits 0, 5, .. 25
+    bits = (bits | bits >> 4) & 0x00300C03u;  // bits 0-1, 10-11, 20-21
+    bits = (bits | bits >> 8) & 0x0030000Fu;  // bits 0-3, 20-21
+    bits = (bits | bits >> 16) & 0x3Fu;
+    present |= bits << (word * HAND_WORD_CARDS);
+  }
+
+  return present;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Running sums of the counter pairs of a hand word: bits 10n to 10n + 9 hold
+/// the cards of pairs 0 to n, at most 186
+///
+/// @param counts word of six 5-bit counters
+///
+/// @return running sums of the three pairs
+//
+static uint32_t pairSums(uint32_t counts)
+{
+  uint32_t pairs = (counts & 0x01F07C1Fu) + ((counts >> 5) & 0x01F07C1Fu);
+  return pairs * 0x00100401u;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Number of cards in a hand, summing all 5-bit counters word by word
+///
+/// @param hand hand
+///
+/// @return number of cards
+//
+int handSize(Hand* hand)
+{
+  int size = 0;
+
+  for (int word = 0; word < HAND_WORDS; word++)
+    size += (int)((pairSums(hand->counts_[word]) >> 20) & 0x3FF);
+
+  return size;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Card at an index of the hand in (spice, value) order, as it gets printed.
+/// Whole words of six counters are skipped by their sum, inside the word the
+/// running sums of its counter pairs find the pair and then the card, so the
+/// cost does not grow with the number of cards or kinds in hand
+///
+/// @param hand hand
+/// @param index index of the card, starting at 0
+///
+/// @return packed card; NO_CARD = index out of bounds
+//
+Card handNth(Hand* hand, int index)
+{
+  if (index < 0)
+    return NO_CARD;
+
+  for (int word = 0; word < HAND_WORDS; word++)
+  {
+    uint32_t running = pairSums(hand->counts_[word]);
+    int total = (int)((running >> 20) & 0x3FF);
+    if (index >= total)
+    {
+      index -= total;
+      continue;
+    }
+
+    int pair = 0;
+    while (index >= (int)((running >> (pair * 10)) & 0x3FF))
+      pair++;
+    if (pair > 0)
+      index -= (int)((running >> ((pair - 1) * 10)) & 0x3FF);
+
+    Card card = (Card)(word * HAND_WORD_CARDS + pair * 2);
+    return (index < handCount(hand, card)) ? card : (Card)(card + 1);
+  }
+
+  return NO_CARD;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Initialising a game on a deck and dealing six cards to each player.
+/// The game reads the cards of the deck but never changes them, so one deck
+/// can be shared by many games. Nothing is allocated
+///
+/// @param game game to initialise
+/// @param deck cards in draw order, drawing starts at the first card
+///
+/// @return no return
+//
+void esp_game_init(EspGame* game, DrawPile* deck)
+{
+  esp_game_init_ring(game, deck->cards_, UINT32_MAX, (uint32_t)deck->size_);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Initialising a game on a deck that is streamed through a ring of cards.
+/// Card n of the deck is ring[n & mask]. The front-end puts more cards into
+/// the ring as they are drawn and raises deck_size_ to match; before each move
+/// ESP_DRAWS_MAX cards have to be ahead unless the deck has ended. Cards stay
+/// readable for esp_unmake until the ring is refilled over them.
+/// Saves need the whole deck and are not supported on rings
+///
+/// @param game game to initialise
+/// @param ring cards of the deck, mask + 1 cards
+/// @param mask size of the ring - 1, a power of two - 1; UINT32_MAX = whole deck
+/// @param size cards put into the ring so far
+///
+/// @return no return
+//
+void esp_game_init_ring(EspGame* game, Card* ring, uint32_t mask, uint32_t size)
+{
+  memset(game, 0, sizeof(EspGame));
+  game->deck_ = ring;
+  game->deck_size_ = size;
+  game->deck_mask_ = mask;
+  game->state_.last_round_loser_ = 1;
+  startRound(game);
+
+  distributeCardsToPlayers(game);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Allocating and initialising a game on a deck
+///
+/// @param deck cards in draw order, must outlive the game
+///
+/// @return new game; NULL = Mem error
+//
+EspGame* esp_game_new(DrawPile* deck)
+{
+  EspGame* game = (EspGame*)malloc(sizeof(EspGame));
+  if (game == NULL)
+    return NULL;
+
+  esp_game_init(game, deck);
+  return game;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Freeing a game from esp_game_new, the deck is not touched
+///
+/// @param game game
+///
+/// @return no return
+//
+void esp_game_free(EspGame* game)
+{
+  free(game);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Listing the moves the player in turn can make, in the order of their move
+/// index. Plays are listed for every card kind in hand with every claim that
+/// is allowed, swaps once for every pair of own card kind and card kind of the
+/// opponent
+///
+/// @param game game
+/// @param moves array for the moves, ESP_MOVES_MAX is always enough
+/// @param capacity size of the array
+///
+/// @return number of moves written; 0 = game over
+//
+int esp_legal_moves(EspGame* game, Move* moves, int capacity)
+{
+  int count = 0;
+  if (esp_is_over(game) != 0)
+    return 0;
+
+  Hand* hand = &game->state_.players_[game->state_.curr_player_ - 1].hand_;
+  Hand* opponent = &game->state_.players_[2 - game->state_.curr_player_].hand_;
+  Move move = { MOVE_QUIT, 1, NO_CARD, NO_CARD, CHALLENGE_NONE, 0 };
+
+  if (count < capacity)
+    moves[count++] = move;
+
+  if (!handIsEmpty(opponent) && count < capacity)
+  {
+    move.kind_ = MOVE_DRAW;
+    moves[count++] = move;
+  }
+
+  if (canChallenge(game))
+  {
+    move.kind_ = MOVE_CHALLENGE;
+    move.parameters_ = 2;
+    for (int type = CHALLENGE_SPICE; type <= CHALLENGE_VALUE && count < capacity; type++)
+    {
+      move.challenge_ = (uint8_t)type;
+      moves[count++] = move;
+    }
+    move.challenge_ = CHALLENGE_NONE;
+  }
+
+  if (!handIsEmpty(opponent))
+  {
+    uint32_t claims = allowedClaims(game);
+
+    move.kind_ = MOVE_PLAY;
+    move.parameters_ = 3;
+    for (uint32_t present = handPresent(hand); present != 0; present &= present - 1)
+    {
+      move.real_card_ = (Card)__builtin_ctz(present);
+      for (uint32_t claim = claims; claim != 0 && count < capacity; claim &= claim - 1)
+      {
+        move.played_card_ = (Card)__builtin_ctz(claim);
+        moves[count++] = move;
+      }
+    }
+  }
+
+  move.kind_ = MOVE_SWAP;
+  move.parameters_ = 3;
+  move.played_card_ = NO_CARD;
+  uint32_t opponent_present = handPresent(opponent);
+  for (uint32_t present = handPresent(hand); present != 0; present &= present - 1)
+  {
+    move.real_card_ = (Card)__builtin_ctz(present);
+    int index = 0;
+    for (uint32_t taken = opponent_present; taken != 0 && count < capacity; taken &= taken - 1)
+    {
+      move.swap_index_ = index;
+      moves[count++] = move;
+      index += handCount(opponent, (Card)__builtin_ctz(taken));
+    }
+  }
+
+  return count;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Marking every legal move of the player in turn in a mask over the move
+/// indices, straight from the hands and the round. Policies can AND it with
+/// their own masks
+///
+/// @param game game
+/// @param mask mask to fill; empty = game over
+///
+/// @return no return
+//
+void esp_legal_mask(EspGame* game, MoveMask* mask)
+{
+  memset(mask, 0, sizeof(MoveMask));
+  if (esp_is_over(game) != 0)
+    return;
+
+  GameState* state = &game->state_;
+  Hand* hand = &state->players_[state->curr_player_ - 1].hand_;
+  Hand* opponent = &state->players_[2 - state->curr_player_].hand_;
+  bool opponent_has_cards = !handIsEmpty(opponent);
+
+  mask->bits_[0] |= 1ull << ESP_INDEX_QUIT;
+  if (opponent_has_cards)
+    mask->bits_[0] |= 1ull << ESP_INDEX_DRAW;
+  if (canChallenge(game))
+    mask->bits_[0] |= 3ull << ESP_INDEX_CHALLENGE;
+
+  uint32_t claims = allowedClaims(game);
+  uint32_t opponent_present = handPresent(opponent);
+
+  for (uint32_t present = handPresent(hand); present != 0; present &= present - 1)
+  {
+    int real = __builtin_ctz(present);
+    if (opponent_has_cards)
+      maskSetBits(mask, ESP_INDEX_PLAY + real * CARD_KINDS, claims);
+    maskSetBits(mask, ESP_INDEX_SWAP + real * CARD_KINDS, opponent_present);
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Index of a move in the move index space
+///
+/// @param game game the move is made in, needed to find the card of a swap
+/// @param move move
+///
+/// @return move index; -1 = the move has no index (unknown command, malformed
+///         cards or swap index out of bounds)
+//
+int esp_move_index(EspGame* game, Move* move)
+{
+  switch (move->kind_)
+  {
+    case MOVE_QUIT:
+      return ESP_INDEX_QUIT;
+    case MOVE_DRAW:
+      return ESP_INDEX_DRAW;
+    case MOVE_CHALLENGE:
+      return (move->challenge_ == CHALLENGE_NONE) ? -1 : ESP_INDEX_CHALLENGE + move->challenge_ - 1;
+    case MOVE_PLAY:
+      if (move->real_card_ >= CARD_KINDS || move->played_card_ >= CARD_KINDS)
+        return -1;
+      return ESP_INDEX_PLAY + move->real_card_ * CARD_KINDS + move->played_card_;
+    case MOVE_SWAP:
+    {
+      Hand* opponent = &game->state_.players_[2 - game->state_.curr_player_].hand_;
+      Card taken = handNth(opponent, move->swap_index_);
+      if (move->real_card_ >= CARD_KINDS || taken == NO_CARD)
+        return -1;
+      return ESP_INDEX_SWAP + move->real_card_ * CARD_KINDS + taken;
+    }
+    default:
+      return -1;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Move of a move index
+///
+/// @param game game the move is made in, needed for the swap index
+/// @param index move index, 0 to ESP_MOVE_INDICES - 1
+/// @param move move to fill
+///
+/// @return no return
+//
+void esp_index_move(EspGame* game, int index, Move* move)
+{
+  moveFromIndex(index, move);
+  if (move->kind_ != MOVE_SWAP)
+    return;
+
+  Hand* opponent = &game->state_.players_[2 - game->state_.curr_player_].hand_;
+  Card taken = (Card)((index - ESP_INDEX_SWAP) % CARD_KINDS);
+  uint32_t below = handPresent(opponent) & ((1u << taken) - 1);
+  for (; below != 0; below &= below - 1)
+    move->swap_index_ += handCount(opponent, (Card)__builtin_ctz(below));
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking a move against the rules without changing the game
+///
+/// @param game game
+/// @param move move of the player in turn
+///
+/// @return ERROR_NONE = legal; ERROR_* = reason the move is not allowed
+//
+int esp_check(EspGame* game, Move* move)
+{
+  if (esp_is_over(game) != 0)
+    return ERROR_TIMING;
+
+  return isValidMove(game, move);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Making a move for the player in turn. Illegal moves are rejected and leave
+/// the game unchanged
+///
+/// @param game game
+/// @param move move of the player in turn
+/// @param outcome challenge result and round end for the front-end; may be NULL
+///
+/// @return ERROR_NONE = move made; ERROR_* = reason the move is not allowed
+//
+int esp_apply(EspGame* game, Move* move, EspOutcome* outcome)
+{
+  EspUndo undo;
+  return esp_make(game, move, outcome, &undo);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Making a move like esp_apply and recording what it changed, so the move can
+/// be taken back with esp_unmake. Moves are unmade in reverse order
+///
+/// @param game game
+/// @param move move of the player in turn
+/// @param outcome challenge result and round end for the front-end; may be NULL
+/// @param undo record to fill, only valid when the move was made
+///
+/// @return ERROR_NONE = move made; ERROR_* = reason the move is not allowed
+//
+int esp_make(EspGame* game, Move* move, EspOutcome* outcome, EspUndo* undo)
+{
+  EspOutcome ignored;
+  if (outcome == NULL)
+    outcome = &ignored;
+  memset(outcome, 0, sizeof(EspOutcome));
+
+  int error = esp_check(game, move);
+  if (error != ERROR_NONE)
+    return error;
+
+  GameState* state = &game->state_;
+  undo->points_[0] = state->players_[0].points_;
+  undo->points_[1] = state->players_[1].points_;
+  undo->pile_next_ = state->pile_next_;
+  undo->cards_played_ = state->cards_played_;
+  undo->kind_ = move->kind_;
+  undo->curr_player_ = state->curr_player_;
+  undo->last_action_ = state->last_action_;
+  undo->curr_spice_ = state->curr_spice_;
+  undo->latest_played_card_ = state->latest_played_card_;
+  undo->latest_real_card_ = state->latest_real_card_;
+  undo->last_round_loser_ = state->last_round_loser_;
+  undo->result_ = state->result_;
+  undo->given_ = move->real_card_;
+  undo->taken_ = NO_CARD;
+  undo->lost_ = 0;
+
+  switch (move->kind_)
+  {
+    case MOVE_PLAY:
+      movePlay(game, move);
+      break;
+    case MOVE_DRAW:
+      game->state_.result_ = Draw(game);
+      break;
+    case MOVE_CHALLENGE:
+      moveChallenge(game, move, outcome);
+      return ERROR_NONE;
+    case MOVE_SWAP:
+      moveSwap(game, move, undo);
+      break;
+    default:
+      game->state_.result_ = QUIT;
+      return ERROR_NONE;
+  }
+
+  if (game->state_.result_ == 0)
+    game->state_.curr_player_ = (game->state_.curr_player_ == 1) ? 2 : 1;
+  return ERROR_NONE;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Taking back the last move made with esp_make
+///
+/// @param game game in the state esp_make left it in
+/// @param undo record of the move
+///
+/// @return no return
+//
+void esp_unmake(EspGame* game, EspUndo* undo)
+{
+  GameState* state = &game->state_;
+  Hand* mover = &state->players_[undo->curr_player_ - 1].hand_;
+  Hand* opponent = &state->players_[2 - undo->curr_player_].hand_;
+
+  switch (undo->kind_)
+  {
+    case MOVE_PLAY:
+      handAdd(mover, undo->given_);
+      break;
+    case MOVE_DRAW:
+    case MOVE_CHALLENGE:
+      unmakeDraws(game, undo);
+      break;
+    case MOVE_SWAP:
+      if (undo->taken_ != NO_CARD)
+      {
+        if (!(undo->lost_ & 2))
+          handRemove(mover, undo->taken_);
+        handAdd(opponent, undo->taken_);
+      }
+      if (undo->given_ != NO_CARD)
+      {
+        if (!(undo->lost_ & 1))
+          handRemove(opponent, undo->given_);
+        handAdd(mover, undo->given_);
+      }
+      break;
+    default:
+      break;
+  }
+
+  state->players_[0].points_ = undo->points_[0];
+  state->players_[1].points_ = undo->points_[1];
+  state->pile_next_ = undo->pile_next_;
+  state->cards_played_ = undo->cards_played_;
+  state->curr_player_ = undo->curr_player_;
+  state->last_action_ = undo->last_action_;
+  state->curr_spice_ = undo->curr_spice_;
+  state->latest_played_card_ = undo->latest_played_card_;
+  state->latest_real_card_ = undo->latest_real_card_;
+  state->last_round_loser_ = undo->last_round_loser_;
+  state->result_ = undo->result_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the game has ended. It ends with quit, with a draw that fails
+/// and once the draw pile is empty at the start of a turn
+///
+/// @param game game
+///
+/// @return 0 = running; 5 = draw pile empty; 6 = hand full; -1 = quit
+//
+int esp_is_over(EspGame* game)
+{
+  if (game->state_.result_ != 0)
+    return game->state_.result_;
+  return isGamePileEmpty(game) ? DRAW_PILE_EMPTY : 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Points of both players
+///
+/// @param game game
+/// @param scores points of player 1 and player 2
+///
+/// @return no return
+//
+void esp_scores(EspGame* game, int scores[2])
+{
+  scores[0] = game->state_.players_[0].points_;
+  scores[1] = game->state_.players_[1].points_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Copying a game. The copy shares the deck and plays on independently
+///
+/// @param copy game to write
+/// @param game game to copy
+///
+/// @return no return
+//
+void esp_game_clone(EspGame* copy, EspGame* game)
+{
+  memcpy(copy, game, sizeof(EspGame));
+}
+
+//------------------------------------------------------------------------------
+///
+/// Writing a game in its stable binary form. Numbers are little-endian, so a
+/// save loads on every machine. Layout of version 2:
+///   0 "ESPS", 4 version, 8 deck size, 12 deck checksum,
+///   16 + 24 * n counts and points of player n + 1, 64 cards drawn,
+///   68 cards played, 72 current player, last action, spice, latest played
+///   card, latest real card, last round loser, result
+///
+/// @param game game
+/// @param buffer ESP_SAVE_SIZE bytes to write
+///
+/// @return no return
+//
+void esp_game_save(EspGame* game, uint8_t buffer[ESP_SAVE_SIZE])
+{
+  GameState* state = &game->state_;
+
+  memset(buffer, 0, ESP_SAVE_SIZE);
+  memcpy(buffer, "ESPS", 4);
+  buffer[4] = ESP_SAVE_VERSION;
+  writeWord(buffer + 8, game->deck_size_);
+  writeWord(buffer + 12, deckChecksum(game->deck_, game->deck_size_));
+
+  for (int player = 0; player < 2; player++)
+  {
+    uint8_t* bytes = buffer + 16 + 24 * player;
+    for (int word = 0; word < HAND_WORDS; word++)
+      writeWord(bytes + 4 * word, state->players_[player].hand_.counts_[word]);
+    writeWord(bytes + 20, (uint32_t)state->players_[player].points_);
+  }
+
+  writeWord(buffer + 64, state->pile_next_);
+  writeWord(buffer + 68, (uint32_t)state->cards_played_);
+  buffer[72] = state->curr_player_;
+  buffer[73] = state->last_action_;
+  buffer[74] = (uint8_t)state->curr_spice_;
+  buffer[75] = state->latest_played_card_;
+  buffer[76] = state->latest_real_card_;
+  buffer[77] = state->last_round_loser_;
+  buffer[78] = (uint8_t)state->result_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Reading a game written by esp_game_save. The game has to be loaded on the
+/// deck it was saved with
+///
+/// @param game game to write, untouched unless the save is loaded
+/// @param deck deck the game was saved with, must outlive the game
+/// @param buffer ESP_SAVE_SIZE bytes of the save
+///
+/// @return 0 = loaded; 1 = not a save or unknown version; 2 = other deck;
+///         3 = invalid game state
+//
+int esp_game_load(EspGame* game, DrawPile* deck, uint8_t buffer[ESP_SAVE_SIZE])
+{
+  if (memcmp(buffer, "ESPS", 4) != 0 || buffer[4] != ESP_SAVE_VERSION)
+    return 1;
+
+  uint32_t deck_size = (uint32_t)deck->size_;
+  if (readWord(buffer + 8) != deck_size || readWord(buffer + 12) != deckChecksum(deck->cards_, deck_size))
+    return 2;
+
+  GameState state;
+  memset(&state, 0, sizeof(GameState));
+
+  for (int player = 0; player < 2; player++)
+  {
+    uint8_t* bytes = buffer + 16 + 24 * player;
+    Hand* hand = &state.players_[player].hand_;
+    for (int word = 0; word < HAND_WORDS; word++)
+    {
+      hand->counts_[word] = readWord(bytes + 4 * word);
+      if (hand->counts_[word] >> (5 * HAND_WORD_CARDS) != 0) // bits past the last counter
+        return 3;
+    }
+    state.players_[player].points_ = (int32_t)readWord(bytes + 20);
+  }
+
+  state.pile_next_ = readWord(buffer + 64);
+  state.cards_played_ = (int32_t)readWord(buffer + 68);
+  state.curr_player_ = buffer[72];
+  state.last_action_ = buffer[73];
+  state.curr_spice_ = (char)buffer[74];
+  state.latest_played_card_ = buffer[75];
+  state.latest_real_card_ = buffer[76];
+  state.last_round_loser_ = buffer[77];
+  state.result_ = (int8_t)buffer[78];
+
+  if (state.pile_next_ > deck_size || state.cards_played_ < 0 ||
+      (state.curr_player_ != 1 && state.curr_player_ != 2) ||
+      (state.last_round_loser_ != 1 && state.last_round_loser_ != 2) ||
+      (state.last_action_ != 0 && state.last_action_ != 1 && state.last_action_ != 3) ||
+      (state.curr_spice_ != 0 && makeCard(1, state.curr_spice_) == NO_CARD) ||
+      (state.latest_played_card_ >= CARD_KINDS && state.latest_played_card_ != NO_CARD) ||
+      (state.latest_real_card_ >= CARD_KINDS && state.latest_real_card_ != NO_CARD) ||
+      (state.result_ != 0 && state.result_ != DRAW_PILE_EMPTY && state.result_ != HAND_FULL &&
+       state.result_ != QUIT))
+    return 3;
+
+  // the round has a latest play of the round spice exactly when cards were played
+  bool has_play = state.cards_played_ > 0;
+  if (has_play ? (state.latest_played_card_ == NO_CARD || state.latest_real_card_ == NO_CARD ||
+      state.curr_spice_ == 0 || cardSpice(state.latest_played_card_) != state.curr_spice_) :
+      (state.latest_played_card_ != NO_CARD || state.latest_real_card_ != NO_CARD || state.curr_spice_ != 0))
+    return 3;
+
+  game->deck_ = deck->cards_;
+  game->deck_size_ = deck_size;
+  game->deck_mask_ = UINT32_MAX;
+  game->state_ = state;
+  return 0;
+}
+
+#ifdef ESP_VERIFY_RULES
+//------------------------------------------------------------------------------
+///
+/// Comparing the rule tables with the validation functions they were compiled
+/// from. Every state the rules look at is built: each last action, the round
+/// start and every latest card with every round spice, opponents without and
+/// with cards. In each state every command is checked with every number of
+/// words, every pair of cards, both challenge types and swap indices around
+/// the bounds of the opponents hand. handNth is checked against a walk over
+/// the cards of hands from one card up to full counters
+///
+/// @return number of moves the tables decide differently; 0 = equivalent
+//
+unsigned long esp_verify_rules(void)
+{
+  static const uint8_t LAST_ACTIONS[] = { 0, 1, 3 };
+  static const int OPPONENT_SIZES[] = { 0, 1, 3 };
+  unsigned long mismatches = 0;
+  DrawPile deck = { NULL, 0, 0, 0 };
+  EspGame game;
+  esp_game_init(&game, &deck);
+  GameState* state = &game.state_;
+
+  // the player holds every even card, so every odd card is missing
+  memset(&state->players_[0].hand_, 0, sizeof(Hand));
+  for (Card card = 0; card < CARD_KINDS; card += 2)
+    handAdd(&state->players_[0].hand_, card);
+
+  for (int latest = -1; latest < CARD_KINDS; latest++)
+  {
+    for (int spice = 0; spice < CARD_SPICES; spice++)
+    {
+      for (size_t action = 0; action < sizeof(LAST_ACTIONS); action++)
+      {
+        for (size_t size = 0; size < sizeof(OPPONENT_SIZES) / sizeof(int); size++)
+        {
+          state->cards_played_ = (latest < 0) ? 0 : 1;
+          state->latest_played_card_ = (latest < 0) ? NO_CARD : (Card)latest;
+          state->curr_spice_ = (latest < 0) ? 0 : "cpw"[spice];
+          state->last_action_ = LAST_ACTIONS[action];
+          memset(&state->players_[1].hand_, 0, sizeof(Hand));
+          for (int card = 0; card < OPPONENT_SIZES[size]; card++)
+            handAdd(&state->players_[1].hand_, (Card)(card * 7));
+
+          for (int kind = MOVE_INVALID; kind <= MOVE_QUIT + 1; kind++)
+          {
+            for (int parameters = 0; parameters <= 4; parameters++)
+            {
+              for (int real = 0; real <= CARD_KINDS; real++)
+              {
+                for (int played = 0; played <= CARD_KINDS; played++)
+                {
+                  for (int detail = 0; detail < 6; detail++)
+                  {
+                    Move move = { (uint8_t)kind, (uint8_t)parameters, (real == CARD_KINDS) ? NO_CARD : (Card)real,
+                      (played == CARD_KINDS) ? NO_CARD : (Card)played, (uint8_t)(detail % 3), detail - 1 };
+                    if (isValidMove(&game, &move) != referenceValidMove(&game, &move))
+                      mismatches++;
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+      if (latest < 0)
+        break; // the round spice is not used at the round start
+    }
+  }
+
+  Hand hand;
+  memset(&hand, 0, sizeof(Hand));
+  for (int added = 0; added < CARD_KINDS * HAND_COPIES_MAX; added++)
+  {
+    handAdd(&hand, (Card)((added * 7) % CARD_KINDS)); // kinds fill up in a scattered order
+    for (int index = -1; index <= added + 1; index++)
+    {
+      if (handNth(&hand, index) != referenceHandNth(&hand, index))
+        mismatches++;
+    }
+  }
+
+  return mismatches;
+}
+#endif // ESP_VERIFY_RULES
+
+//------------------------------------------------------------------------------
+///
+/// Resetting the round, the loser of the last round starts
+///
+/// @param game game
+///
+/// @return no return
+//
+static void startRound(EspGame* game)
+{
+  game->state_.curr_player_ = game->state_.last_round_loser_;
+  game->state_.cards_played_ = 0;
+  game->state_.last_action_ = 0;
+  game->state_.curr_spice_ = 0;
+  game->state_.latest_played_card_ = NO_CARD;
+  game->state_.latest_real_card_ = NO_CARD;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Dealing six cards to each player, alternating between the players
+///
+/// @param game game
+///
+/// @return no return
+//
+static void distributeCardsToPlayers(EspGame* game)
+{
+  int curr_card = 0;
+
+  while (curr_card < 12 && !isGamePileEmpty(game))
+  {
+    Card card = game->deck_[game->state_.pile_next_++ & game->deck_mask_]; // 1. card from the pile
+
+    handAdd(&game->state_.players_[curr_card % 2].hand_, card);
+
+    curr_card++;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// If the command is play, the real card leaves the hand and the played card
+/// becomes the card to beat
+///
+/// @param game game
+/// @param move legal play
+///
+/// @return no return
+//
+static void movePlay(EspGame* game, Move* move)
+{
+  game->state_.latest_real_card_ = move->real_card_;
+  game->state_.latest_played_card_ = move->played_card_;
+  game->state_.curr_spice_ = cardSpice(move->played_card_);
+
+  handRemove(&game->state_.players_[game->state_.curr_player_ - 1].hand_, move->real_card_);
+
+  game->state_.cards_played_++;
+  game->state_.last_action_ = 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// If the command was "draw" => add card to hand after command: draw
+/// and update last_action
+///
+/// @param game game
+///
+/// @return 5 = empty draw_pile; 6 = hand full; 0 = successfully drawed
+//
+static int Draw(EspGame* game)
+{
+  int draw_checker = addDrawedCard(game, &game->state_.players_[game->state_.curr_player_ - 1]);
+  if (draw_checker != 0)
+  {
+    return draw_checker;
+  }
+  game->state_.last_action_ = 1;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// If the command is challenge, the latest play gets revealed, the points are
+/// awarded and the round ends with the loser drawing cards
+///
+/// @param game game
+/// @param move legal challenge
+/// @param outcome revealed cards, points and round end
+///
+/// @return no return
+//
+static void moveChallenge(EspGame* game, Move* move, EspOutcome* outcome)
+{
+  Card played = game->state_.latest_played_card_;
+  Card real = game->state_.latest_real_card_;
+  bool matches = (move->challenge_ == CHALLENGE_SPICE) ? cardSpice(played) == cardSpice(real) :
+    cardValue(played) == cardValue(real);
+
+  game->state_.last_action_ = 3;
+  outcome->challenge_ = move->challenge_;
+  outcome->challenge_successful_ = !matches;
+  outcome->played_card_ = played;
+  outcome->real_card_ = real;
+
+  int loser = awardChallenge(game, !matches, outcome);
+  game->state_.last_round_loser_ = loser;
+
+  game->state_.result_ = endRound(game, loser);
+  if (game->state_.result_ == 0)
+  {
+    startRound(game);
+    outcome->round_over_ = true;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Awarding the points of a challenge: the cards played in the round go to the
+/// challenger when the challenge is successful and to the other player when it
+/// fails, who gets 10 bonus points on top for playing the last card
+///
+/// @param game game
+/// @param challenge_successful successful or failed
+/// @param outcome points awarded
+///
+/// @return loser of the round
+//
+static int awardChallenge(EspGame* game, bool challenge_successful, EspOutcome* outcome)
+{
+  int curr_player = game->state_.curr_player_;
+  int scorer = challenge_successful ? curr_player : 3 - curr_player;
+  Player* player = &game->state_.players_[scorer - 1];
+
+  outcome->scorer_ = scorer;
+  outcome->points_ = game->state_.cards_played_;
+  player->points_ += game->state_.cards_played_;
+
+  if (!challenge_successful && handIsEmpty(&player->hand_))
+  {
+    outcome->bonus_ = 10;
+    player->points_ += 10;
+  }
+
+  return 3 - scorer;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Loser of the round draws two cards, the other player draws six when the
+/// hand is empty
+///
+/// @param game game
+/// @param loser loser of the round
+///
+/// @return 5 = empty draw pile; 6 = hand full; 0 = successful draw
+//
+static int endRound(EspGame* game, int loser)
+{
+  Player* loser_p = &game->state_.players_[loser - 1];
+  Player* winner_p = &game->state_.players_[2 - loser];
+
+  int draw_checker = drawTwoCards(game, loser_p);
+  if (draw_checker == 0 && handIsEmpty(&winner_p->hand_))
+    draw_checker = drawSixCards(game, winner_p);
+
+  return draw_checker;
+}
+
+//------------------------------------------------------------------------------
+///
+/// If the command is swap, the given card from the current players hand gets
+/// exchanged with the card at the index of the opponents hand
+///
+/// @param game game
+/// @param move swap
+/// @param undo record of the cards that moved
+///
+/// @return no return
+//
+static void moveSwap(EspGame* game, Move* move, EspUndo* undo)
+{
+  Player* player = &game->state_.players_[game->state_.curr_player_ - 1];
+  Player* player2 = &game->state_.players_[2 - game->state_.curr_player_];
+  Card given = move->real_card_;
+
+  bool was_in_hand = handRemove(&player->hand_, given);
+  Card taken = deleteWhenIndex(player2, move->swap_index_);
+
+  if (taken != NO_CARD && !handAdd(&player->hand_, taken))
+    undo->lost_ |= 2;
+  if (was_in_hand && !handAdd(&player2->hand_, given))
+    undo->lost_ |= 1;
+
+  undo->given_ = was_in_hand ? given : NO_CARD;
+  undo->taken_ = taken;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Taking the cards drawn by a draw or a challenge back out of the hands. The
+/// mover drew them after a draw, after a challenge the loser drew the first two
+/// and the winner the rest. A draw that failed with a full hand took the card
+/// from the pile without adding it
+///
+/// @param game game after the move
+/// @param undo record of the move
+///
+/// @return no return
+//
+static void unmakeDraws(EspGame* game, EspUndo* undo)
+{
+  GameState* state = &game->state_;
+  int receiver = (undo->kind_ == MOVE_DRAW) ? undo->curr_player_ : state->last_round_loser_;
+  uint32_t end = state->pile_next_;
+
+  if (state->result_ == HAND_FULL)
+    end--;
+
+  for (uint32_t next = undo->pile_next_; next != end; next++)
+  {
+    int player = (undo->kind_ == MOVE_CHALLENGE && next - undo->pile_next_ >= 2) ? 3 - receiver : receiver;
+    handRemove(&state->players_[player - 1].hand_, game->deck_[next & game->deck_mask_]);
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Removing the card at an index of the players hand
+///
+/// @param curr_p player
+/// @param index index of the card in the printed hand, starting at 0
+///
+/// @return removed card; NO_CARD = index out of bounds
+//
+static Card deleteWhenIndex(Player* curr_p, int index)
+{
+  Card card = handNth(&curr_p->hand_, index);
+  handRemove(&curr_p->hand_, card);
+  return card;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Loser draws two cards
+///
+/// @param game game
+/// @param p player
+///
+/// @return 5 = empty draw pile; 6 = hand full; 0 = successful draw
+//
+static int drawTwoCards(EspGame* game, Player* p)
+{
+  for (int i = 0; i < 2; i++)
+  {
+    int draw_checker = addDrawedCard(game, p);
+    if (draw_checker != 0)
+      return draw_checker;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Winner with empty hand draws six cards
+///
+/// @param game game
+/// @param p player
+///
+/// @return 5 = empty draw pile; 6 = hand full; 0 = successful draw
+//
+static int drawSixCards(EspGame* game, Player* p)
+{
+  for (int i = 0; i < 6; i++)
+  {
+    int draw_checker = addDrawedCard(game, p);
+    if (draw_checker != 0)
+      return draw_checker;
+  }
+
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if all cards of the deck have been drawn in this game. The cursor
+/// never passes deck_size_, on a ring both count on past 2^32
+///
+/// @param game game
+///
+/// @return false = cards left; true = empty
+//
+static bool isGamePileEmpty(EspGame* game)
+{
+  return game->state_.pile_next_ == game->deck_size_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Add the top card of the draw pile to a hand
+///
+/// @param game game
+/// @param p player that is drawing
+///
+/// @return 5 = empty draw_pile; 6 = HAND_COPIES_MAX copies of the card in hand;
+///         0 = successfully drawed
+//
+static int addDrawedCard(EspGame* game, Player* p)
+{
+  if (isGamePileEmpty(game))
+  {
+    return 5; // Draw pile empty
+  }
+
+  return handAdd(&p->hand_, game->deck_[game->state_.pile_next_++ & game->deck_mask_]) ? 0 : 6;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking a move in the order the errors are reported to the player. The
+/// rules are looked up in COMMAND_TIMING and CLAIM_VALUES, only the cards have
+/// to be looked for in the hands
+///
+/// @param game game
+/// @param move move of the player in turn
+///
+/// @return ERROR_NONE = valid; ERROR_* = first rule the move breaks
+//
+static int isValidMove(EspGame* game, Move* move)
+{
+  GameState* state = &game->state_;
+  Hand* hand = &state->players_[state->curr_player_ - 1].hand_;
+  Hand* opponent = &state->players_[2 - state->curr_player_].hand_;
+
+  if (move->kind_ == MOVE_INVALID || move->kind_ > MOVE_QUIT)
+    return ERROR_COMMAND;
+  if (move->parameters_ < PARAMETER_COUNTS[move->kind_][0] || move->parameters_ > PARAMETER_COUNTS[move->kind_][1])
+    return ERROR_PARAMETERS;
+  if ((allowedCommands(game) & 1u << move->kind_) == 0)
+    return ERROR_TIMING;
+
+  switch (move->kind_)
+  {
+    case MOVE_PLAY:
+    {
+      if (move->real_card_ == NO_CARD || move->played_card_ == NO_CARD)
+        return ERROR_FORMAT;
+      if (handCount(hand, move->real_card_) == 0)
+        return ERROR_HAND;
+      int latest_value = (state->cards_played_ > 0) ? cardValue(state->latest_played_card_) : 0;
+      if ((CLAIM_VALUES[latest_value] >> (cardValue(move->played_card_) - 1) & 1) == 0)
+        return ERROR_VALUE;
+      if (state->cards_played_ > 0 && cardSpice(move->played_card_) != state->curr_spice_)
+        return ERROR_SPICE;
+      return ERROR_NONE;
+    }
+    case MOVE_CHALLENGE:
+      return (move->challenge_ == CHALLENGE_NONE) ? ERROR_CHALLENGE_TYPE : ERROR_NONE;
+    case MOVE_SWAP:
+      if (move->real_card_ == NO_CARD)
+        return ERROR_FORMAT;
+      if (handCount(hand, move->real_card_) == 0)
+        return ERROR_HAND;
+      if (move->swap_index_ < 0 || move->swap_index_ >= handSize(opponent))
+        return ERROR_INDEX;
+      return ERROR_NONE;
+    default:
+      return ERROR_NONE;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Commands the player in turn may use at the moment
+///
+/// @param game game
+///
+/// @return bit MOVE_* set = command allowed
+//
+static uint8_t allowedCommands(EspGame* game)
+{
+  GameState* state = &game->state_;
+  bool opponent_empty = handIsEmpty(&state->players_[2 - state->curr_player_].hand_);
+  return COMMAND_TIMING[state->last_action_ & 3][state->cards_played_ > 0][opponent_empty];
+}
+
+#ifdef ESP_VERIFY_RULES
+//------------------------------------------------------------------------------
+///
+/// Checking a move with the validation functions the tables were compiled
+/// from, for esp_verify_rules
+///
+/// @param game game
+/// @param move move of the player in turn
+///
+/// @return ERROR_NONE = valid; ERROR_* = first rule the move breaks
+//
+static int referenceValidMove(EspGame* game, Move* move)
+{
+  if (!isCommandValid(move))
+    return ERROR_COMMAND;
+  if (!isParameterValid(move))
+    return ERROR_PARAMETERS;
+  if (!isCommandTimedRight(game, move))
+    return ERROR_TIMING;
+  if (move->kind_ == MOVE_PLAY && !isFormatValid(move))
+    return ERROR_FORMAT;
+  if (move->kind_ == MOVE_PLAY && !isInHand(move, &game->state_.players_[game->state_.curr_player_ - 1]))
+    return ERROR_HAND;
+  if (move->kind_ == MOVE_PLAY)
+  {
+    int play_error = isValidCurrentPlay(game, move);
+    if (play_error != ERROR_NONE)
+      return play_error;
+  }
+  if (move->kind_ == MOVE_CHALLENGE && !isValidChallengeType(move))
+    return ERROR_CHALLENGE_TYPE;
+  if (move->kind_ == MOVE_SWAP && move->real_card_ == NO_CARD)
+    return ERROR_FORMAT;
+  if (move->kind_ == MOVE_SWAP && !isInHand(move, &game->state_.players_[game->state_.curr_player_ - 1]))
+    return ERROR_HAND;
+  if (move->kind_ == MOVE_SWAP && !isValidSwap(game, move))
+    return ERROR_INDEX;
+
+  return ERROR_NONE;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the swap index points at a card of the opponent
+///
+/// @param game game
+/// @param move swap
+///
+/// @return false = index out of bounds; true = valid
+//
+static bool isValidSwap(EspGame* game, Move* move)
+{
+  int count = handSize(&game->state_.players_[2 - game->state_.curr_player_].hand_);
+
+  return move->swap_index_ >= 0 && move->swap_index_ < count;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the command has valid number of parameters
+///
+/// @param move move
+///
+/// @return false = invalid; true = valid
+//
+static bool isParameterValid(Move* move)
+{
+  if (move->kind_ == MOVE_QUIT && move->parameters_ > 1)
+  {
+    return false;
+  }
+  else if (move->kind_ == MOVE_DRAW && move->parameters_ > 1)
+  {
+    return false;
+  }
+  else if (move->kind_ == MOVE_CHALLENGE && move->parameters_ != 2)
+  {
+    return false;
+  }
+  else if ((move->kind_ == MOVE_PLAY || move->kind_ == MOVE_SWAP) && move->parameters_ != 3)
+  {
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the commands are overall valid
+///
+/// @param move move
+///
+/// @return false = invalid; true = valid
+//
+static bool isCommandValid(Move* move)
+{
+  return move->kind_ == MOVE_QUIT || move->kind_ == MOVE_DRAW ||
+    move->kind_ == MOVE_PLAY || move->kind_ == MOVE_CHALLENGE || move->kind_ == MOVE_SWAP;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the commands are valid for the turn
+///
+/// @param game game
+/// @param move move
+///
+/// @return false = invalid; true = valid
+//
+static bool isCommandTimedRight(EspGame* game, Move* move)
+{
+  if (move->kind_ == MOVE_CHALLENGE && game->state_.cards_played_ == 0)
+  {
+    return false;
+  }
+  else if (move->kind_ == MOVE_CHALLENGE && (game->state_.last_action_ == 1 || game->state_.last_action_ == 2))
+  {
+    return false;
+  }
+  else if (move->kind_ == MOVE_PLAY || move->kind_ == MOVE_DRAW)
+  {
+    if (handIsEmpty(&game->state_.players_[2 - game->state_.curr_player_].hand_))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the input format is valid for command "play"
+///
+/// @param move move
+///
+/// @return false = invalid; true = valid
+//
+static bool isFormatValid(Move* move)
+{
+  return move->real_card_ != NO_CARD && move->played_card_ != NO_CARD;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the the real card played is in hand of the player
+///
+/// @param move move
+/// @param p player
+///
+/// @return false = not in hand; true = in hand
+//
+static bool isInHand(Move* move, Player* p)
+{
+  return move->real_card_ != NO_CARD && handCount(&p->hand_, move->real_card_) > 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the claimed card of a play may follow the latest played card
+///
+/// @param game game
+/// @param move play
+///
+/// @return ERROR_NONE = valid; ERROR_VALUE = wrong value; ERROR_SPICE = wrong spice
+//
+static int isValidCurrentPlay(EspGame* game, Move* move)
+{
+  int value_played_card = cardValue(move->played_card_);
+  char spice_played_card = cardSpice(move->played_card_);
+
+  if (game->state_.cards_played_ == 0)
+  {
+    if (value_played_card > 3)
+      return ERROR_VALUE;
+  }
+  else
+  {
+    int latest_value = cardValue(game->state_.latest_played_card_);
+
+    if (latest_value == 10)
+    {
+      if (value_played_card > 3 || value_played_card < 1)
+        return ERROR_VALUE;
+    }
+    else
+    {
+      if (latest_value >= value_played_card)
+        return ERROR_VALUE;
+    }
+    
+    if (game->state_.curr_spice_ != spice_played_card)
+      return ERROR_SPICE;
+  }
+  
+  return ERROR_NONE;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the challenges type is spice or value 
+///
+/// @param move move
+///
+/// @return false = invalid; true = valid
+//
+static bool isValidChallengeType(Move* move)
+{
+  return move->challenge_ != CHALLENGE_NONE;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Card at an index of the hand, walking kind by kind, for esp_verify_rules
+///
+/// @param hand hand
+/// @param index index of the card, starting at 0
+///
+/// @return packed card; NO_CARD = index out of bounds
+//
+static Card referenceHandNth(Hand* hand, int index)
+{
+  uint32_t present = handPresent(hand);
+
+  while (present != 0 && index >= 0)
+  {
+    Card card = (Card)__builtin_ctz(present);
+    int count = handCount(hand, card);
+    if (index < count)
+      return card;
+
+    index -= count;
+    present &= present - 1;
+  }
+
+  return NO_CARD;
+}
+#endif // ESP_VERIFY_RULES
+
+//------------------------------------------------------------------------------
+///
+/// Checking if the player in turn may challenge: only after a card was played
+/// in the round and not right after a draw
+///
+/// @param game game
+///
+/// @return false = no challenge; true = challenge allowed
+//
+static bool canChallenge(EspGame* game)
+{
+  return (allowedCommands(game) & 1u << MOVE_CHALLENGE) != 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Cards that may be claimed in the round: values 1 to 3 of any spice to start,
+/// else higher values of the round spice, wrapping around to 1 to 3 after a 10
+///
+/// @param game game
+///
+/// @return card set, bit n = card n may be claimed
+//
+static uint32_t allowedClaims(EspGame* game)
+{
+  uint32_t values = CLAIM_VALUES[0];
+  if (game->state_.cards_played_ == 0)
+    return values | values << CARD_VALUES | values << (2 * CARD_VALUES);
+
+  values = CLAIM_VALUES[cardValue(game->state_.latest_played_card_)];
+  return values << makeCard(1, game->state_.curr_spice_);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Move of a move index, a swap gets swap index 0 for the caller to fill in
+///
+/// @param index move index
+/// @param move move to fill
+///
+/// @return no return
+//
+static void moveFromIndex(int index, Move* move)
+{
+  move->real_card_ = NO_CARD;
+  move->played_card_ = NO_CARD;
+  move->challenge_ = CHALLENGE_NONE;
+  move->swap_index_ = 0;
+
+  if (index == ESP_INDEX_QUIT || index == ESP_INDEX_DRAW)
+  {
+    move->kind_ = (index == ESP_INDEX_QUIT) ? MOVE_QUIT : MOVE_DRAW;
+    move->parameters_ = 1;
+  }
+  else if (index < ESP_INDEX_PLAY)
+  {
+    move->kind_ = MOVE_CHALLENGE;
+    move->parameters_ = 2;
+    move->challenge_ = (uint8_t)(index - ESP_INDEX_CHALLENGE + 1);
+  }
+  else if (index < ESP_INDEX_SWAP)
+  {
+    move->kind_ = MOVE_PLAY;
+    move->parameters_ = 3;
+    move->real_card_ = (Card)((index - ESP_INDEX_PLAY) / CARD_KINDS);
+    move->played_card_ = (Card)((index - ESP_INDEX_PLAY) % CARD_KINDS);
+  }
+  else
+  {
+    move->kind_ = MOVE_SWAP;
+    move->parameters_ = 3;
+    move->real_card_ = (Card)((index - ESP_INDEX_SWAP) / CARD_KINDS);
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Setting the bits of a card set in a mask, starting at a move index
+///
+/// @param mask mask
+/// @param offset move index of bit 0 of the card set
+/// @param bits card set, bit n = card n
+///
+/// @return no return
+//
+static void maskSetBits(MoveMask* mask, int offset, uint32_t bits)
+{
+  int word = offset / 64;
+  int shift = offset % 64;
+
+  mask->bits_[word] |= (uint64_t)bits << shift;
+  if (shift > 64 - CARD_KINDS)
+    mask->bits_[word + 1] |= (uint64_t)bits >> (64 - shift);
+}
+
+//------------------------------------------------------------------------------
+///
+/// FNV-1a hash of the cards of a deck, so a save is not loaded on another deck
+///
+/// @param cards cards of the deck
+/// @param size number of cards
+///
+/// @return checksum
+//
+static uint32_t deckChecksum(Card* cards, uint32_t size)
+{
+  uint32_t hash = 2166136261u;
+  for (uint32_t i = 0; i < size; i++)
+  {
+    hash ^= cards[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Writing a 32-bit number little-endian
+///
+/// @param bytes 4 bytes to write
+/// @param word number
+///
+/// @return no return
+//
+static void writeWord(uint8_t* bytes, uint32_t word)
+{
+  bytes[0] = (uint8_t)word;
+  bytes[1] = (uint8_t)(word >> 8);
+  bytes[2] = (uint8_t)(word >> 16);
+  bytes[3] = (uint8_t)(word >> 24);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Reading a little-endian 32-bit number
+///
+/// @param bytes 4 bytes to read
+///
+/// @return number
+//
+static uint32_t readWord(uint8_t* bytes)
+{
+  return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
@@ -0,0 +1,242 @@
+#ifndef ESP_H
+#define ESP_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// libesp: rules and state of Entertaining Spice Pretending.
+// The library does no I/O and keeps no globals, every game lives in its own
+// EspGame, so any number of games can be played at once from different threads.
+
+#define CARD_VALUES 10
+#define CARD_SPICES 3
+#define CARD_KINDS (CARD_VALUES * CARD_SPICES)
+#define NO_CARD 0xFF
+#define HAND_COPIES_MAX 31
+#define HAND_WORD_CARDS 6   // 5-bit counters per word of a hand
+#define HAND_WORDS 5
+#define DECK_SIZE_MAX UINT32_MAX
+
+// most cards a game draws before the next move can be made: the deal, a
+// challenge draws at most 2 + 6
+#define ESP_DRAWS_MAX 12
+
+// quit and draw, two challenges, every play of a card kind at a round start
+// (values 1 to 3 of each spice) and every swap of a card kind for a card kind
+#define ESP_MOVES_MAX (4 + CARD_KINDS * 9 + CARD_KINDS * CARD_KINDS)
+
+// fixed index space of all moves: quit, draw, the two challenges, then every
+// play of a real card with a claimed card and every swap of a given card for
+// a taken card kind
+#define ESP_INDEX_QUIT 0
+#define ESP_INDEX_DRAW 1
+#define ESP_INDEX_CHALLENGE 2 // + CHALLENGE_* - 1
+#define ESP_INDEX_PLAY 4      // + real * CARD_KINDS + claimed
+#define ESP_INDEX_SWAP (ESP_INDEX_PLAY + CARD_KINDS * CARD_KINDS) // + given * CARD_KINDS + taken
+#define ESP_MOVE_INDICES (ESP_INDEX_SWAP + CARD_KINDS * CARD_KINDS)
+#define ESP_MASK_WORDS ((ESP_MOVE_INDICES + 63) / 64)
+
+// size of a game in its stable binary form, see esp_game_save
+#define ESP_SAVE_SIZE 80
+#define ESP_SAVE_VERSION 2
+
+enum {
+  GAME_END,
+  WRONG_USAGE,
+  CANT_OPEN_FILE,
+  INVALID_FILE,
+  ALLOC_FAIL,
+  DRAW_PILE_EMPTY,
+  HAND_FULL,
+  QUIT = -1
+};
+
+enum {
+  MOVE_INVALID,
+  MOVE_PLAY,
+  MOVE_DRAW,
+  MOVE_CHALLENGE,
+  MOVE_SWAP,
+  MOVE_QUIT
+};
+
+enum {
+  CHALLENGE_NONE,
+  CHALLENGE_SPICE,
+  CHALLENGE_VALUE
+};
+
+enum {
+  ERROR_NONE,
+  ERROR_COMMAND,
+  ERROR_PARAMETERS,
+  ERROR_TIMING,
+  ERROR_FORMAT,
+  ERROR_HAND,
+  ERROR_VALUE,
+  ERROR_SPICE,
+  ERROR_CHALLENGE_TYPE,
+  ERROR_INDEX
+};
+
+// spice index (c, p, w) * 10 + value - 1, so ascending ids are sorted by (spice, value)
+typedef uint8_t Card;
+
+// the cards in hand follow from the counters, see handPresent
+typedef struct _Hand_
+{
+  uint32_t counts_[HAND_WORDS]; // 5-bit number of copies of each card, 6 cards per word
+} Hand;
+
+typedef struct _DrawPile_
+{
+  Card* cards_;
+  size_t size_;
+  size_t next_; // read cursor, the pile is empty once it reaches size_
+  size_t mapped_; // bytes mapped for a binary deck, cards_ lies in the mapping; 0 = allocated
+} DrawPile;
+
+typedef struct _Player_
+{
+  Hand hand_;
+  int points_;
+} Player;
+
+// one move, cards are NO_CARD when missing or malformed
+typedef struct _Move_
+{
+  uint8_t kind_;       // MOVE_*
+  uint8_t parameters_; // number of words the move was given with
+  Card real_card_;     // play: card from the hand; swap: card to give
+  Card played_card_;   // play: claimed card
+  uint8_t challenge_;  // CHALLENGE_*
+  int swap_index_;     // swap: index into the opponents hand
+} Move;
+
+// everything that changes during a game, plain data of at most 64 bytes, so a
+// game is copied with a single memcpy (see esp_game_clone)
+typedef struct _GameState_
+{
+  Player players_[2];
+  uint32_t pile_next_;        // cards drawn from the deck so far
+  int32_t cards_played_;      // cards played in round
+  uint8_t curr_player_;       // 1 or 2
+  uint8_t last_action_;       // 0 = play, 1 = draw, 3 = challenge
+  char curr_spice_;           // spice of the round
+  Card latest_played_card_;
+  Card latest_real_card_;
+  uint8_t last_round_loser_;
+  int8_t result_;             // 0 = running; 5 = draw pile empty; 6 = hand full; -1 = quit
+} GameState;
+
+_Static_assert(sizeof(GameState) <= 64, "GameState must stay within one cache line");
+
+typedef struct _EspGame_
+{
+  Card* deck_;                // shared with the deck and never written
+  uint32_t deck_size_;        // cards put on the deck so far, pile_next_ counts up to it
+  uint32_t deck_mask_;        // card n is deck_[n & deck_mask_]; UINT32_MAX = whole deck
+  GameState state_;
+} EspGame;
+
+// one bit per move index, bit n of word n / 64 is index n
+typedef struct _MoveMask_
+{
+  uint64_t bits_[ESP_MASK_WORDS];
+} MoveMask;
+
+// what esp_make changed, enough for esp_unmake to restore the game exactly.
+// Cards drawn by the move are not stored, they are found again on the deck
+typedef struct _EspUndo_
+{
+  int32_t points_[2];
+  uint32_t pile_next_;
+  int32_t cards_played_;
+  uint8_t kind_;              // MOVE_* that was made
+  uint8_t curr_player_;
+  uint8_t last_action_;
+  char curr_spice_;
+  Card latest_played_card_;
+  Card latest_real_card_;
+  uint8_t last_round_loser_;
+  int8_t result_;
+  Card given_;                // play: card from the hand; swap: card given, NO_CARD = none
+  Card taken_;                // swap: card taken, NO_CARD = none
+  uint8_t lost_;              // swap: 1 = given card, 2 = taken card did not fit into the hand
+} EspUndo;
+
+// what happened during esp_apply, for the front-end to show
+typedef struct _EspOutcome_
+{
+  int challenge_;             // CHALLENGE_NONE = the move was no challenge
+  bool challenge_successful_;
+  Card played_card_;          // claimed and real card revealed by the challenge
+  Card real_card_;
+  int scorer_;                // player getting the points of the challenge
+  int points_;
+  int bonus_;                 // 10 = the scorer played the last card
+  bool round_over_;           // the next turn starts a new round
+} EspOutcome;
+
+Card makeCard(int value, char spice);
+
+int cardValue(Card card);
+
+char cardSpice(Card card);
+
+int handCount(Hand* hand, Card card);
+
+bool handAdd(Hand* hand, Card card);
+
+bool handRemove(Hand* hand, Card card);
+
+bool handIsEmpty(Hand* hand);
+
+uint32_t handPresent(Hand* hand);
+
+int handSize(Hand* hand);
+
+Card handNth(Hand* hand, int index);
+
+bool isPileEmpty(DrawPile* draw_pile);
+
+void esp_game_init(EspGame* game, DrawPile* deck);
+
+void esp_game_init_ring(EspGame* game, Card* ring, uint32_t mask, uint32_t size);
+
+EspGame* esp_game_new(DrawPile* deck);
+
+void esp_game_free(EspGame* game);
+
+int esp_legal_moves(EspGame* game, Move* moves, int capacity);
+
+void esp_legal_mask(EspGame* game, MoveMask* mask);
+
+int esp_move_index(EspGame* game, Move* move);
+
+void esp_index_move(EspGame* game, int index, Move* move);
+
+int esp_check(EspGame* game, Move* move);
+
+int esp_apply(EspGame* game, Move* move, EspOutcome* outcome);
+
+int esp_make(EspGame* game, Move* move, EspOutcome* outcome, EspUndo* undo);
+
+void esp_unmake(EspGame* game, EspUndo* undo);
+
+int esp_is_over(EspGame* game);
+
+void esp_scores(EspGame* game, int scores[2]);
+
+void esp_game_clone(EspGame* copy, EspGame* game);
+
+void esp_game_save(EspGame* game, uint8_t buffer[ESP_SAVE_SIZE]);
+
+int esp_game_load(EspGame* game, DrawPile* deck, uint8_t buffer[ESP_SAVE_SIZE]);
+
+#ifdef ESP_VERIFY_RULES
+unsigned long esp_verify_rules(void);
+#endif
+
+#endif // ESP_H
@@ -3,1575 +3,1926 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
 
 #include "main.h"
+#include "runner.h"
+#include "bench.h"
+#include "stats.h"
+#include "mcts.h"
+#include "cfr.h"
+#include "solver.h"
 
 //------------------------------------------------------------------------------
 //
 /// The main program.
-/// Initialises the draw pile and players, connects all logic with functions and 
-/// returns appropriate values to corresponding endings
+/// Parses the options and either plays an interactive game or runs the
+/// headless simulation, alone or on a pool of threads with --threads.
+/// --p1 and --p2 put a human, the random bot, the ISMCTS bot or the bot of a
+/// strategy table on a seat, --train-cfr trains such a table and --solve
+/// solves a game with all cards known.
+/// --bench-parse measures the move parser on a file of
+/// recorded move lines and --bench-load the config loader, --verify-undo and
+/// --bench-search check and measure esp_make/esp_unmake, --bench runs the
+/// microbenchmarks of the engine and --bench-replay replays recorded games.
+/// Builds with ESP_VERIFY_RULES add --verify-rules
 ///
 /// @param argc program name
-/// @param argv file name
+/// @param argv options followed by the file name
 ///
 /// @return 1 = wrong usage; 2 = file not open; 3 = not a valid file; 
 ///         4 = alloc fail; 0 = End
 //
 int main(int argc, char* argv[])
 {
-  if (argc != 2)
+  if (argc == 3 && strcmp(argv[1], "--bench-parse") == 0)
+    return benchParse(argv[2]);
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "--bench-load") == 0)
+    return benchLoad(argv[2], (argc == 4) ? atoi(argv[3]) : 0);
+  if (argc == 4 && strcmp(argv[1], "--verify-undo") == 0)
+    return verifyUndo(argv[3], strtoul(argv[2], NULL, 10));
+  if (argc == 4 && strcmp(argv[1], "--bench-search") == 0)
+    return benchSearch(argv[3], atoi(argv[2]));
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "--bench") == 0)
+    return runBenchmarks(argv[2], (argc == 4) ? argv[3] : NULL);
+  if (argc >= 4 && argc <= 6 && strcmp(argv[1], "--bench-replay") == 0)
+  {
+    char* end = NULL;
+    double max_regression = (argc == 6) ? strtod(argv[5], &end) : REPLAY_MAX_REGRESSION;
+    if (argc == 6 && (end == argv[5] || *end != '\0' || !(max_regression >= 0)))
+    {
+      printf("%s", USAGE);
+      return WRONG_USAGE;
+    }
+    return benchReplay(argv[2], argv[3], (argc >= 5) ? argv[4] : NULL, max_regression);
+  }
+  if ((argc == 5 || argc == 6) && strcmp(argv[1], "--train-cfr") == 0)
+    return trainCfr(argv[3], argv[4], strtoul(argv[2], NULL, 10), (argc == 6) ? atoi(argv[5]) : 1, 1);
+  if ((argc == 5 || argc == 6) && strcmp(argv[1], "--solve") == 0)
+    return solveGame(argv[4], (argc == 6) ? argv[5] : NULL, atoi(argv[2]), atoi(argv[3]));
+#ifdef ESP_VERIFY_RULES
+  if (argc == 2 && strcmp(argv[1], "--verify-rules") == 0)
+    return verifyRules();
+#endif
+
+  Options options;
+  if (parseOptions(argc, argv, &options) != 0)
   {
-    printf("Usage: ./main <config file>\n");
+    printf("%s", USAGE);
     return WRONG_USAGE;
   }
-  Card* draw_pile = NULL;
-  Player p1, p2;
-  initialisePlayers(&p1, &p2);
 
-  int extractionCheck = extractCardsFromFile(argv[1], &draw_pile);
+  if (options.generate_)
+    return generateDecks(&options);
+  if (options.simulate_ && options.threads_ > 0)
+    return runGames(&options);
+  if (options.stats_)
+    installStatsSignal();
+
+  int result = options.simulate_ ? simulateGames(&options) : playGame(&options);
+  if (options.stats_)
+    printPhaseStats(stderr);
+  return result;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Parsing the command line options, each option but --stats takes one value
+/// and the config file comes last. --stream names the deck instead of the config file
+///
+/// @param argc number of arguments
+/// @param argv arguments
+/// @param options parsed options
+///
+/// @return 1 = wrong usage; 0 = Valid
+//
+int parseOptions(int argc, char* argv[], Options* options)
+{
+  options->simulate_ = false;
+  options->games_ = 0;
+  options->seed_ = 1;
+  options->record_name_ = NULL;
+  options->render_mode_ = -1;
+  options->save_name_ = NULL;
+  options->resume_name_ = NULL;
+  options->config_name_ = NULL;
+  options->stream_ = false;
+  options->shuffle_ = false;
+  options->shuffle_seed_ = 0;
+  options->generate_ = false;
+  options->decks_ = 0;
+  options->composition_ = NULL;
+  options->deck_format_ = DECK_BINARY;
+  options->threads_ = 0;
+  options->stats_ = false;
+  for (int seat = 0; seat < 2; seat++)
+    options->seats_[seat] = (SeatOption){ SEAT_DEFAULT, 0, 0, NULL };
+
+  bool formatted = false;
+  bool seeded = false;
+  int arg = 1;
+  for (; arg + 1 < argc; arg += 2)
+  {
+    if (strcmp(argv[arg], "--stats") == 0) // the only option without a value
+    {
+      options->stats_ = true;
+      arg--;
+      continue;
+    }
+
+    char* value = argv[arg + 1];
+    if (strcmp(argv[arg], "--simulate") == 0)
+    {
+      options->simulate_ = true;
+      options->games_ = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[arg], "--seed") == 0)
+    {
+      options->seed_ = strtoull(value, NULL, 10);
+      seeded = true;
+    }
+    else if (strcmp(argv[arg], "--record") == 0)
+      options->record_name_ = value;
+    else if (strcmp(argv[arg], "--save") == 0)
+      options->save_name_ = value;
+    else if (strcmp(argv[arg], "--resume") == 0)
+      options->resume_name_ = value;
+    else if (strcmp(argv[arg], "--stream") == 0)
+    {
+      options->stream_ = true;
+      options->config_name_ = value;
+    }
+    else if (strcmp(argv[arg], "--shuffle") == 0)
+    {
+      options->shuffle_ = true;
+      options->shuffle_seed_ = strtoull(value, NULL, 10);
+    }
+    else if (strcmp(argv[arg], "--generate-decks") == 0)
+    {
+      options->generate_ = true;
+      options->decks_ = strtoul(value, NULL, 10);
+    }
+    else if (strcmp(argv[arg], "--threads") == 0 && atoi(value) > 0)
+      options->threads_ = atoi(value);
+    else if (strcmp(argv[arg], "--p1") == 0 || strcmp(argv[arg], "--p2") == 0)
+    {
+      if (parseSeat(value, &options->seats_[argv[arg][3] - '1']) != 0)
+        return WRONG_USAGE;
+    }
+    else if (strcmp(argv[arg], "--composition") == 0)
+      options->composition_ = value;
+    else if (strcmp(argv[arg], "--format") == 0 && (strcmp(value, "text") == 0 || strcmp(value, "binary") == 0))
+    {
+      options->deck_format_ = (strcmp(value, "text") == 0) ? DECK_TEXT : DECK_BINARY;
+      formatted = true;
+    }
+    else if (strcmp(argv[arg], "--output") == 0 && strcmp(value, "text") == 0)
+      options->render_mode_ = RENDER_TEXT;
+    else if (strcmp(argv[arg], "--output") == 0 && strcmp(value, "events") == 0)
+      options->render_mode_ = RENDER_EVENTS;
+    else if (strcmp(argv[arg], "--output") == 0 && strcmp(value, "off") == 0)
+      options->render_mode_ = RENDER_OFF;
+    else
+      return WRONG_USAGE;
+  }
+
+  // a streamed deck takes the place of the config file, it cannot be saved or shuffled
+  bool random_stream = options->stream_ && strncmp(options->config_name_, RANDOM_DECK_PREFIX,
+    strlen(RANDOM_DECK_PREFIX)) == 0;
+  bool seated[5] = { false }; // by SEAT_*
+  for (int seat = 0; seat < 2; seat++)
+    seated[options->seats_[seat].kind_] = true;
+  bool bot_seat = seated[SEAT_RANDOM] || seated[SEAT_MCTS] || seated[SEAT_CFR];
+  if (arg != argc - (options->stream_ ? 0 : 1) ||
+      (seeded && !options->simulate_ && !random_stream && !options->generate_ && !bot_seat) ||
+      ((options->simulate_ || options->stream_) && (options->save_name_ != NULL || options->resume_name_ != NULL)) ||
+      (options->stream_ && options->shuffle_))
+    return WRONG_USAGE;
+
+  // generating decks plays no game, a simulation has nobody to read moves from
+  if ((!options->generate_ && (options->composition_ != NULL || formatted)) ||
+      (options->generate_ && (options->simulate_ || options->stream_ || options->shuffle_ ||
+       options->record_name_ != NULL || options->save_name_ != NULL || options->resume_name_ != NULL ||
+       options->render_mode_ >= 0 || seated[SEAT_HUMAN] || bot_seat)) ||
+      (options->simulate_ && seated[SEAT_HUMAN]))
+    return WRONG_USAGE;
+
+  // the workers of --threads share nothing but the deck, they neither stream, record nor render
+  // and only play random bots. Phase statistics are kept per thread and only printed for
+  // single-threaded runs
+  if (options->threads_ > 0 && (!options->simulate_ || options->stream_ || options->record_name_ != NULL ||
+      (options->render_mode_ >= 0 && options->render_mode_ != RENDER_OFF) || options->stats_ ||
+      seated[SEAT_MCTS] || seated[SEAT_CFR]))
+    return WRONG_USAGE;
+  if (options->generate_ && options->stats_)
+    return WRONG_USAGE;
+
+  if (!options->stream_)
+    options->config_name_ = argv[arg];
+  if (options->render_mode_ < 0)
+    options->render_mode_ = options->simulate_ ? RENDER_OFF : RENDER_TEXT;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Parsing the value of --p1 or --p2: human, random, mcts:<ms>ms[:<threads>]
+/// or cfr:<table file>
+///
+/// @param value option value
+/// @param seat seat option to fill
+///
+/// @return 1 = wrong usage; 0 = Valid
+//
+int parseSeat(char* value, SeatOption* seat)
+{
+  seat->budget_ms_ = 0;
+  seat->threads_ = 0;
+  seat->table_name_ = NULL;
+  if (strcmp(value, "human") == 0)
+    seat->kind_ = SEAT_HUMAN;
+  else if (strcmp(value, "random") == 0)
+    seat->kind_ = SEAT_RANDOM;
+  else if (strncmp(value, "mcts:", 5) == 0 && parseMctsSeat(value + 5, &seat->budget_ms_, &seat->threads_) == 0)
+    seat->kind_ = SEAT_MCTS;
+  else if (strncmp(value, "cfr:", 4) == 0 && value[4] != '\0')
+  {
+    seat->kind_ = SEAT_CFR;
+    seat->table_name_ = value + 4;
+  }
+  else
+    return WRONG_USAGE;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Plays one interactive game with both players reading from stdin, unless
+/// --p1 or --p2 put a bot on their seat. Initialises the draw pile and
+/// players, connects all logic with functions and returns appropriate values
+/// to corresponding endings. With --resume the game
+/// continues from a save, with --save a quit writes the game to a save.
+/// With --stream the draw pile is refilled from the deck during the game,
+/// with --shuffle the deck is played in the order of game 0 of the seed
+///
+/// @param options parsed options
+///
+/// @return 2 = file not open; 3 = not a valid file; 4 = alloc fail; 0 = End
+//
+int playGame(Options* options)
+{
+  char* file_name = options->config_name_;
+  DrawPile draw_pile = { NULL, 0, 0, 0 };
+  StreamDeck stream_deck;
+  StreamDeck* stream = options->stream_ ? &stream_deck : NULL;
+
+  int load_check = (stream != NULL) ? openStreamDeck(stream, file_name, options->seed_) :
+    loadDeck(file_name, &draw_pile);
+  if (load_check != 0)
+    return load_check;
 
-  if (extractionCheck == 1)
+  if (options->shuffle_ && shuffleDeck(&draw_pile, options->shuffle_seed_, 0) != 0)
   {
-    printf("Error: Cannot open file: %s\n", argv[1]);
-    return CANT_OPEN_FILE;
+    freeCards(&draw_pile);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
   }
-  else if (extractionCheck == 2)
+
+  EspGame game;
+  if (stream == NULL)
+    esp_game_init(&game, &draw_pile);
+  else if (startStreamGame(stream, &game) != 0)
   {
-    printf("Error: Invalid file: %s\n", argv[1]);
+    freeDeck(&draw_pile, stream);
     return INVALID_FILE;
   }
-  else if (extractionCheck == 3)
+  Player* p1 = &game.state_.players_[0];
+  Player* p2 = &game.state_.players_[1];
+
+  if (options->resume_name_ != NULL)
   {
+    load_check = loadGame(options->resume_name_, &game, &draw_pile);
+    if (load_check != 0)
+    {
+      freeDeck(&draw_pile, stream);
+      printf(load_check == 1 ? "Error: Cannot open file: %s\n" : "Error: Invalid save file: %s\n",
+        options->resume_name_);
+      return load_check == 1 ? CANT_OPEN_FILE : INVALID_FILE;
+    }
+  }
+
+  LineReader input;
+  Renderer renderer;
+  if (initialiseLineReader(&input, STDIN_FILENO) != 0)
+  {
+    freeDeck(&draw_pile, stream);
     printf("Error: Out of memory\n");
-    return INVALID_FILE;
+    return ALLOC_FAIL;
+  }
+  if (initialiseRenderer(&renderer, options->render_mode_, stdout) != 0)
+  {
+    freeLineReader(&input);
+    freeDeck(&draw_pile, stream);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+  HumanSeat human = { &input, &renderer };
+  Session session;
+  SeatBots bots;
+  initialiseSession(&session, &human, &renderer);
+  session.stream_ = stream;
+  int seat_check = seatPlayers(&session, options, &bots);
+  if (seat_check != 0)
+  {
+    freeRenderer(&renderer);
+    freeLineReader(&input);
+    freeDeck(&draw_pile, stream);
+    return seat_check;
+  }
+  if (options->record_name_ != NULL && (session.record_ = fopen(options->record_name_, "w")) == NULL)
+  {
+    unseatPlayers(&bots);
+    freeRenderer(&renderer);
+    freeLineReader(&input);
+    freeDeck(&draw_pile, stream);
+    printf("Error: Cannot open file: %s\n", options->record_name_);
+    return CANT_OPEN_FILE;
   }
 
-  printf("Welcome to Entertaining Spice Pretending!\n");
+  renderWelcome(&renderer);
 
-  distributeCardsToPlayers(&draw_pile, &p1, &p2);
-  sortPlayerHand(&p1);
-  sortPlayerHand(&p2);
+  int gameplay_checker = gameplay(&session, &game);
+  if (gameplay_checker == DRAW_PILE_EMPTY || gameplay_checker == HAND_FULL)
+    renderResults(&renderer, p1, p2);
+  freeRenderer(&renderer);
+  freeLineReader(&input);
+  reportSeats(&bots, stderr);
+  unseatPlayers(&bots);
+  if (session.record_ != NULL)
+    fclose(session.record_);
 
-  int gameplay_checker = gameplay(&draw_pile, &p1, &p2);
   if (gameplay_checker == ALLOC_FAIL) // MEM ERROR
   {
-    freeAll(draw_pile, p1.hand_, p2.hand_);
+    freeDeck(&draw_pile, stream);
     printf("Error: Out of memory\n");
     return ALLOC_FAIL;
   }
-  else if (gameplay_checker == DRAW_PILE_EMPTY) // draw_pile empty
+  else if (gameplay_checker == INVALID_FILE) // invalid card further down a streamed deck
+  {
+    freeDeck(&draw_pile, stream);
+    return INVALID_FILE;
+  }
+  else if (gameplay_checker == DRAW_PILE_EMPTY || gameplay_checker == HAND_FULL) // draw_pile empty
   {
-    printResults(&p1, &p2);
-    freeAll(draw_pile, p1.hand_, p2.hand_);
-    appendResults(argv[1], &p1, &p2);
+    bool generated = stream != NULL && stream->generated_;
+    freeDeck(&draw_pile, stream);
+    PHASE_START(persist);
+    if (!generated)
+      appendResults(file_name, p1, p2);
+    PHASE_STOP(PHASE_PERSIST, persist);
     return GAME_END;
   }
   else if (gameplay_checker == QUIT) // quit
   {
-    freeAll(draw_pile, p1.hand_, p2.hand_);
+    PHASE_START(persist);
+    int save_check = (options->save_name_ != NULL) ? saveGame(options->save_name_, &game) : 0;
+    PHASE_STOP(PHASE_PERSIST, persist);
+    freeDeck(&draw_pile, stream);
+    if (save_check != 0)
+    {
+      printf("Error: Cannot open file: %s\n", options->save_name_);
+      return CANT_OPEN_FILE;
+    }
     return GAME_END;
   }
 
-  appendResults(argv[1], &p1, &p2);
-  freeAll(draw_pile, p1.hand_, p2.hand_);
+  PHASE_START(persist);
+  appendResults(file_name, p1, p2);
+  PHASE_STOP(PHASE_PERSIST, persist);
+  freeDeck(&draw_pile, stream);
   return GAME_END;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Initialising players hands and points
-///
-/// @param p1 player 1
-/// @param p2 player 2
-///
-/// @return no return
-//
-void initialisePlayers(Player* p1, Player* p2)
-{
-  p1->hand_ = NULL;
-  p1->points_ = 0;
-
-  p2->hand_ = NULL;
-  p2->points_ = 0;
-}
-
-//------------------------------------------------------------------------------
-///
-/// Extracting cards from a valid file
+/// Plays complete games between two bots and reports the throughput. Both
+/// seats are random bots unless --p1 or --p2 put the ISMCTS bot on them.
+/// Nothing is rendered during play unless an output mode is chosen.
+/// The deck is loaded once and shared by all games, a streamed deck starts
+/// over for every game. With --shuffle game n plays the deck shuffled by the
+/// seed and n, so runs split over several processes deal the same games
 ///
-/// @param draw_pile command (move from player) 
-/// @param p1 player 1
-/// @param p2 player 2
+/// @param options parsed options with the number of games, seed and config file
 ///
-/// @return 1 = file not open; 2 = not a valid file; 
-///         3 = alloc fail; 0 = Valid
+/// @return 2 = file not open; 3 = not a valid file; 4 = alloc fail; 0 = End
 //
-int extractCardsFromFile(char* file_name, Card** draw_pile)
+int simulateGames(Options* options)
 {
-  char line[10] = {0};
-  int value = 0;
-  char spice = 0;
+  char* file_name = options->config_name_;
+  unsigned long games = options->games_;
+  uint64_t seed = options->seed_;
+  DrawPile deck = { NULL, 0, 0, 0 };
+  StreamDeck stream_deck;
+  StreamDeck* stream = options->stream_ ? &stream_deck : NULL;
+  int load_check = (stream != NULL) ? openStreamDeck(stream, file_name, seed) : loadDeck(file_name, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  // every game shuffles the deck in the order of the config file again
+  Card* unshuffled = NULL;
+  if (options->shuffle_)
+  {
+    unshuffled = (Card*)malloc((deck.size_ == 0) ? 1 : deck.size_);
+    if (unshuffled != NULL)
+      memcpy(unshuffled, deck.cards_, deck.size_);
+    if (unshuffled == NULL || shuffleDeck(&deck, 0, 0) != 0) // a mapped deck becomes writable
+    {
+      free(unshuffled);
+      freeCards(&deck);
+      printf("Error: Out of memory\n");
+      return ALLOC_FAIL;
+    }
+  }
 
-  FILE* file = fopen(file_name, "r");
-  if (file == NULL)
+  Renderer renderer;
+  if (initialiseRenderer(&renderer, options->render_mode_, stdout) != 0)
   {
-    return 1; // FILE NOT ABLE TO BE OPENED [ 1 ]
+    free(unshuffled);
+    freeDeck(&deck, stream);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
   }
 
-  if (fgets(line, sizeof(line), file) == NULL || strcmp(line, "ESP\n") != 0)
+  SeatBots bots;
+  Session session;
+  initialiseSession(&session, NULL, &renderer);
+  session.stream_ = stream;
+  int seat_check = seatPlayers(&session, options, &bots);
+  if (seat_check != 0)
+  {
+    freeRenderer(&renderer);
+    free(unshuffled);
+    freeDeck(&deck, stream);
+    return seat_check;
+  }
+  if (options->record_name_ != NULL && (session.record_ = fopen(options->record_name_, "w")) == NULL)
   {
-    fclose(file);
-    return 2; // NOT A VALID FILE (Not ESP first)
+    unseatPlayers(&bots);
+    freeRenderer(&renderer);
+    free(unshuffled);
+    freeDeck(&deck, stream);
+    printf("Error: Cannot open file: %s\n", options->record_name_);
+    return CANT_OPEN_FILE;
   }
 
-  while (fscanf(file, "%d_%c", &value, &spice) == 2)
+  unsigned long wins[3] = { 0 }; // draws, player 1, player 2
+  unsigned long warm_turns = 0;
+  size_t warm_allocations = 0;
+  size_t warm_frees = 0;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  for (unsigned long game_index = 0; game_index < games; game_index++)
   {
-    Card* new_card = (Card*) malloc(sizeof(Card));
-    if (new_card == NULL)
+    if (game_index == 1) // the first game may set up stdio buffers, the rest must not allocate
     {
-      fclose(file);
-      freeCards(*draw_pile);
-      new_card = NULL;
-      return 3; // failed allocation [ 3 ]
+      warm_turns = session.turns_;
+      warm_allocations = allocationCount();
+      warm_frees = freeCount();
     }
 
-    new_card->value_ = value;
-    new_card->spice_ = spice;
-    new_card->next_card_ = NULL;
-
-    Card* curr = *draw_pile;
-    if (*draw_pile == NULL)
+    EspGame game;
+    int gameplay_checker = 0;
+    if (unshuffled != NULL)
     {
-      *draw_pile = new_card;
+      memcpy(deck.cards_, unshuffled, deck.size_);
+      shuffleCards(deck.cards_, deck.size_, options->shuffle_seed_, game_index);
     }
-    else
+    if (stream == NULL)
+      esp_game_init(&game, &deck);
+    else if (game_index > 0 && rewindPileStream(&stream->pile_) != 0)
     {
-      while (curr->next_card_ != NULL)
-      {
-        curr = curr->next_card_;
-      }
-      curr->next_card_ = new_card;
+      printf("Error: Cannot read file again: %s\n", file_name);
+      gameplay_checker = CANT_OPEN_FILE;
+    }
+    else if (startStreamGame(stream, &game) != 0)
+      gameplay_checker = INVALID_FILE;
+    Player* p1 = &game.state_.players_[0];
+    Player* p2 = &game.state_.players_[1];
+
+    if (gameplay_checker == 0)
+      gameplay_checker = gameplay(&session, &game);
+    if (gameplay_checker == ALLOC_FAIL || gameplay_checker == CANT_OPEN_FILE || gameplay_checker == INVALID_FILE)
+    {
+      unseatPlayers(&bots);
+      freeRenderer(&renderer);
+      free(unshuffled);
+      freeDeck(&deck, stream);
+      if (session.record_ != NULL)
+        fclose(session.record_);
+      if (gameplay_checker == ALLOC_FAIL)
+        printf("Error: Out of memory\n");
+      return gameplay_checker;
     }
-  }
 
-  fclose(file);
-  return 0;
+    renderResults(&renderer, p1, p2);
+    renderFlush(&renderer);
+
+    if (p1->points_ == p2->points_)
+      wins[0]++;
+    else
+      wins[(p1->points_ > p2->points_) ? 1 : 2]++;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  size_t play_allocations = allocationCount() - warm_allocations;
+  size_t play_frees = freeCount() - warm_frees;
+  freeRenderer(&renderer);
+  double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+  printf("Simulated %lu games in %.3f s (%.0f games/sec)\n", games, seconds,
+    (seconds > 0) ? (double)games / seconds : 0.0);
+  printf("Player 1 wins: %lu\nPlayer 2 wins: %lu\nDraws: %lu\n", wins[1], wins[2], wins[0]);
+  reportSeats(&bots, stdout);
+#ifdef ESP_COUNT_ALLOCATIONS
+  if (games > 1)
+    printf("Steady state: %zu allocations, %zu frees in %lu turns\n", play_allocations, play_frees,
+      session.turns_ - warm_turns);
+#else
+  (void)warm_turns;
+  (void)play_allocations;
+  (void)play_frees;
+#endif
+
+  unseatPlayers(&bots);
+  free(unshuffled);
+  freeDeck(&deck, stream);
+  if (session.record_ != NULL)
+    fclose(session.record_);
+  return GAME_END;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Distributing the cards from draw pile to player
+/// Writes a corpus of shuffled decks of one composition. Deck n is the
+/// composition in ascending order shuffled by the seed and n, the same deck
+/// game n of --shuffle plays on a config file of that order
 ///
-/// @param draw_pile command (move from player) 
-/// @param p1 player 1
-/// @param p2 player 2
+/// @param options number of decks, seed, composition, format and name prefix
 ///
-/// @return no return
+/// @return 1 = invalid composition; 2 = file not written; 4 = alloc fail; 0 = End
 //
-void distributeCardsToPlayers(Card** draw_pile, Player* p1, Player* p2)
+int generateDecks(Options* options)
 {
-  int curr_card = 0;
+  uint32_t counts[CARD_KINDS];
+  char* composition = (options->composition_ != NULL) ? options->composition_ : DEFAULT_COMPOSITION;
+  if (parseComposition(composition, counts) != 0)
+  {
+    printf("Error: Invalid composition: %s\n", composition);
+    return WRONG_USAGE;
+  }
 
-  while (curr_card < 12)
+  DrawPile sorted = { NULL, 0, 0, 0 };
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int compose_check = composeDeck(counts, &sorted);
+  if (compose_check == 0)
+    compose_check = composeDeck(counts, &deck);
+  if (compose_check != 0)
   {
-    Card* curr = *draw_pile; // 1. card from the pile
-    *draw_pile = curr->next_card_; // new head for the draw pile
-    curr->next_card_ = NULL;
+    freeCards(&sorted);
+    printf(compose_check == 2 ? "Error: Invalid composition: %s\n" : "Error: Out of memory\n", composition);
+    return (compose_check == 2) ? WRONG_USAGE : ALLOC_FAIL;
+  }
 
-    if (curr_card % 2 == 0)
-    {
-      if (p1->hand_ == NULL)
-      {
-        p1->hand_ = curr;
-      }
-      else
-      {
-        Card* temp = p1->hand_;
-        while (temp->next_card_ != NULL)
-        {
-          temp = temp->next_card_;
-        }
-        temp->next_card_ = curr;
-      }
-    }
-    else
+  size_t prefix_length = strlen(options->config_name_);
+  char* file_name = (char*)malloc(prefix_length + 32);
+  if (file_name == NULL)
+  {
+    freeCards(&deck);
+    freeCards(&sorted);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  int result = GAME_END;
+  for (unsigned long index = 0; index < options->decks_ && result == GAME_END; index++)
+  {
+    memcpy(deck.cards_, sorted.cards_, sorted.size_);
+    shuffleCards(deck.cards_, deck.size_, options->seed_, index);
+    snprintf(file_name, prefix_length + 32, "%s%06lu%s", options->config_name_, index,
+      (options->deck_format_ == DECK_BINARY) ? ".bin" : ".txt");
+    if (writeDeck(file_name, &deck, options->deck_format_) != 0)
     {
-      if (p2->hand_ == NULL)
-      {
-        p2->hand_ = curr;
-      }
-      else
-      {
-        Card* temp = p2->hand_;
-        while (temp->next_card_ != NULL)
-        {
-          temp = temp->next_card_;
-        }
-        temp->next_card_ = curr;
-      }
+      printf("Error: Cannot open file: %s\n", file_name);
+      result = CANT_OPEN_FILE;
     }
-
-    curr_card++;
   }
+
+  if (result == GAME_END)
+    printf("Generated %lu decks of %zu cards\n", options->decks_, deck.size_);
+  free(file_name);
+  freeCards(&deck);
+  freeCards(&sorted);
+  return result;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Sorting players hand using bubble sort
+/// Shuffling a loaded deck in place by a seed and a game index, a mapped
+/// binary deck is copied first
 ///
-/// @param p player
+/// @param deck loaded deck
+/// @param seed seed of the run
+/// @param game index of the game in the run
 ///
-/// @return no return
+/// @return 4 = alloc fail; 0 = Valid
 //
-void sortPlayerHand(Player* p)
+int shuffleDeck(DrawPile* deck, uint64_t seed, uint64_t game)
 {
-  if (p->hand_ != NULL)
+  if (deck->mapped_ != 0)
   {
-    int swapped = 0;
-    do
-    {
-      swapped = 0;
-      Card** curr_c = &(p->hand_);
-
-      while ((*curr_c)->next_card_ != NULL)
-      {
-        Card* prev = *curr_c;
-        Card* temp = prev->next_card_;
-
-        if ((prev->spice_ > temp->spice_) || (prev->spice_ == temp->spice_ && prev->value_ > temp->value_))
-        {
-          prev->next_card_ = temp->next_card_;
-          temp->next_card_ = prev;
-          *curr_c = temp;
+    size_t size = deck->size_;
+    Card* cards = (Card*)malloc((size == 0) ? 1 : size);
+    if (cards == NULL)
+      return ALLOC_FAIL;
+    memcpy(cards, deck->cards_, size);
+    freeCards(deck);
+    deck->cards_ = cards;
+    deck->size_ = size;
+  }
 
-          swapped = 1;
-        }
+  shuffleCards(deck->cards_, deck->size_, seed, game);
+  return 0;
+}
 
-        Card* tranverse = *curr_c;
-        curr_c = &(tranverse)->next_card_;
-      }
-    } while (swapped == 1);
+//------------------------------------------------------------------------------
+///
+/// Initialising a session with two human seats reading from the same input
+///
+/// @param session session to initialise
+/// @param human input and prompt output of the human seats
+/// @param renderer output of the game
+///
+/// @return no return
+//
+void initialiseSession(Session* session, HumanSeat* human, Renderer* renderer)
+{
+  for (int seat = 0; seat < 2; seat++)
+  {
+    session->seats_[seat].provide_ = humanMove;
+    session->seats_[seat].context_ = human;
   }
+  session->renderer_ = renderer;
+  session->turns_ = 0;
+  session->record_ = NULL;
+  session->stream_ = NULL;
+  session->stats_ = NULL;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Function where the results are checked and where the logic for endgame is
+/// Putting the bots of --p1 and --p2 on their seats. A seat left at its
+/// default keeps the human of a game and gets the random bot of a simulation,
+/// random bot n is seeded with seed * 2 + n as before there were seat options
 ///
-/// @param draw_pile command (move from player) 
-/// @param p1 player 1
-/// @param p2 player 2
+/// @param session session with the human seats
+/// @param options seat options, seed and mode
+/// @param bots bots to initialise
 ///
-/// @return 4 = Mem error; 5 = endgame(drawpile empty); 0 = Valid Play / Draw; 
-///         8 = Valid challenge; -1 = Valid quit
+/// @return 2 = table not open; 3 = not a valid table; 4 = Mem error; 0 = Valid
 //
-int gameplay(Card** draw_pile, Player* p1, Player* p2)
+int seatPlayers(Session* session, Options* options, SeatBots* bots)
 {
-  int last_round_loser = 1;
-  while (true)
+  for (int seat = 0; seat < 2; seat++)
   {
-    printf("\n-------------------\nROUND START\n-------------------\n");
-    int curr_turn = last_round_loser;
-    int cards_played_in_round = 0;
-    int last_action = 0; // 0=play, 1=draw, 2=challenge
-    char curr_spice = 0;
-    char* latest_real_card = NULL;
-    char* latest_played_card = NULL;
-
-    while (true)
-    {
-      if (*draw_pile == NULL)
-      {
-        freeLatest(&latest_played_card, &latest_real_card);
-        return 5;
-      }
-
-      int return_checker = turnsInGameplay(draw_pile, p1, p2, &curr_turn, &curr_spice,
-        &latest_played_card, &latest_real_card, &cards_played_in_round, &last_action, &last_round_loser);
+    bots->mcts_[seat] = NULL;
+    bots->cfr_[seat] = NULL;
+  }
 
-      if (return_checker == 4 || return_checker == 5 || return_checker == -1)
-        return return_checker;
+  for (int seat = 0; seat < 2; seat++)
+  {
+    SeatOption* option = &options->seats_[seat];
+    int kind = (option->kind_ != SEAT_DEFAULT) ? option->kind_ : (options->simulate_ ? SEAT_RANDOM : SEAT_HUMAN);
+    bots->random_[seat].state_ = options->seed_ * 2 + 1 + (uint64_t)seat;
 
-      if (return_checker == 8)
-        break;
+    if (kind == SEAT_RANDOM)
+    {
+      session->seats_[seat].provide_ = randomMove;
+      session->seats_[seat].context_ = &bots->random_[seat];
     }
-
-    if (last_round_loser == 1)
+    else if (kind == SEAT_MCTS)
     {
-      if (drawTwoCards(draw_pile, p1) == 5)
-      {
-        freeLatest(&latest_played_card, &latest_real_card);
-        return 5;
-      }
-
-      if (p2->hand_ == NULL)
+      MctsBot* bot = (MctsBot*)malloc(sizeof(MctsBot));
+      if (bot == NULL || initialiseMctsBot(bot, option->budget_ms_, option->threads_,
+          counterRandom(options->seed_, 0, (uint64_t)seat)) != 0)
       {
-        if (drawSixCards(draw_pile, p2) == 5)
-        {
-          freeLatest(&latest_played_card, &latest_real_card);
-          return 5;
-        }
+        free(bot);
+        unseatPlayers(bots);
+        printf("Error: Out of memory\n");
+        return ALLOC_FAIL;
       }
+      bots->mcts_[seat] = bot;
+      session->seats_[seat].provide_ = mctsMove;
+      session->seats_[seat].context_ = bot;
     }
-    else if (last_round_loser == 2)
+    else if (kind == SEAT_CFR)
     {
-      if (drawTwoCards(draw_pile, p2) == 5)
-      {
-        freeLatest(&latest_played_card, &latest_real_card);
-        return 5;
-      }
-
-      if (p1->hand_ == NULL)
+      CfrBot* bot = (CfrBot*)malloc(sizeof(CfrBot));
+      int open_check = (bot == NULL) ? ALLOC_FAIL :
+        openCfrBot(bot, option->table_name_, counterRandom(options->seed_, 0, (uint64_t)seat));
+      if (open_check != 0)
       {
-        if (drawSixCards(draw_pile, p1) == 5)
-        {
-          freeLatest(&latest_played_card, &latest_real_card);
-          return 5;
-        }
+        free(bot);
+        unseatPlayers(bots);
+        if (open_check == ALLOC_FAIL)
+          printf("Error: Out of memory\n");
+        else
+          printf(open_check == CANT_OPEN_FILE ? "Error: Cannot open file: %s\n" : "Error: Invalid strategy table: %s\n",
+            option->table_name_);
+        return open_check;
       }
+      bots->cfr_[seat] = bot;
+      session->seats_[seat].provide_ = cfrMove;
+      session->seats_[seat].context_ = bot;
     }
   }
-
-  if (*draw_pile == NULL)
-  {
-    return 5;
-  }
-
   return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Prints players hand
+/// Stopping and freeing the mcts and table bots of the seats
 ///
-/// @param p player
+/// @param bots bots
 ///
-/// @return 4 = Mem error; 0 = Valid
+/// @return no return
 //
-void printPlayerHand(Player* p)
+void unseatPlayers(SeatBots* bots)
 {
-  Card* curr_p1 = (*p).hand_;
-
-  printf("    hand cards:");
-  while (curr_p1 != NULL)
+  for (int seat = 0; seat < 2; seat++)
   {
-    printf(" %d_%c", curr_p1->value_, curr_p1->spice_);
-    curr_p1 = curr_p1->next_card_;
+    if (bots->mcts_[seat] != NULL)
+    {
+      freeMctsBot(bots->mcts_[seat]);
+      free(bots->mcts_[seat]);
+      bots->mcts_[seat] = NULL;
+    }
+    if (bots->cfr_[seat] != NULL)
+    {
+      closeCfrBot(bots->cfr_[seat]);
+      free(bots->cfr_[seat]);
+      bots->cfr_[seat] = NULL;
+    }
   }
-  printf("\n");
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Function that check whose player is on in the round, and passes info for printing
+/// Printing the moves and playouts/sec of the mcts bots and the time per
+/// move of the table bots of the seats
 ///
-/// @param draw_pile command (move from player) 
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param curr_turn current turn
-/// @param curr_spice spice of the round
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param cards_played_in_round cards played in round 
-/// @param last_action latest action (turn before)
-/// @param loser loser of the round
+/// @param bots bots
+/// @param out stream to print to
 ///
-/// @return 4 = Mem error; 5 = endgame(drawpile empty); 0 = Valid Play / Draw; 
-///         8 = Valid challenge; -1 = Valid quit
+/// @return no return
 //
-int turnsInGameplay(Card** draw_pile, Player* p1, Player* p2, int* curr_turn, char* curr_spice,
-  char** latest_played_card, char** latest_real_card, int* cards_played_in_round, int* last_action, int* loser)
+void reportSeats(SeatBots* bots, FILE* out)
 {
-  Player* curr_player = (*curr_turn == 1) ? p1 : p2;
-  printPlayerInfo(p1, p2, curr_turn, *curr_turn, *latest_played_card, *cards_played_in_round);
-  printPlayerHand(curr_player);
-
-  int checker = inputMove(curr_player, p1, p2, draw_pile, *curr_turn, curr_spice,
-                  latest_played_card, latest_real_card, cards_played_in_round, last_action, loser);
-
-  if (checker == 4 || checker == 5 || checker == -1 || checker == 8)
+  for (int seat = 0; seat < 2; seat++)
   {
-    freeLatest(latest_played_card, latest_real_card);
-    return checker;
+    if (bots->mcts_[seat] != NULL)
+      reportMctsBot(bots->mcts_[seat], seat + 1, out);
+    if (bots->cfr_[seat] != NULL)
+      reportCfrBot(bots->cfr_[seat], seat + 1, out);
   }
-
-  *curr_turn = (*curr_turn == 1) ? 2 : 1;
-  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Prints infos of the player during the round
+/// Loading the deck of a config file and reporting why it could not be loaded
 ///
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param curr_player current player in turn
-/// @param curr_turn current turn
-/// @param latest_played_card bluff card from the play before
-/// @param cards_played cards played in round 
+/// @param file_name config file
+/// @param deck draw pile to fill
 ///
-/// @return no return
+/// @return 2 = file not open; 3 = not a valid file; 4 = alloc fail; 0 = Valid
 //
-void printPlayerInfo(Player* p1, Player* p2, int* curr_player, int curr_turn,
-  char* latest_played_card, int cards_played_in_round)
+int loadDeck(char* file_name, DrawPile* deck)
 {
-  Player* player = (*curr_player == 1) ? p2 : p1;
-  if (player->hand_ == NULL)
+  size_t error_line = 0;
+  int extraction_check = extractCardsFromFile(file_name, 0, deck, &error_line);
+  if (extraction_check == 1)
   {
-    printf("\nPlayer %i:\n"
-      "    latest played card: %s LAST CARD\n"
-      "    cards played this round: %i\n", curr_turn, latest_played_card, cards_played_in_round);
+    printf("Error: Cannot open file: %s\n", file_name);
+    return CANT_OPEN_FILE;
   }
-  else
+  else if (extraction_check == 2)
   {
-    if (latest_played_card == NULL)
-    {
-      printf("\nPlayer %i:\n"
-        "    latest played card:\n"
-        "    cards played this round: %i\n", curr_turn, cards_played_in_round);
-    }
+    if (error_line == 0)
+      printf("Error: Invalid file: %s\n", file_name);
     else
-    {
-      printf("\nPlayer %i:\n"
-        "    latest played card: %s\n"
-        "    cards played this round: %i\n", curr_turn, latest_played_card, cards_played_in_round);
-    }
+      printf("Error: Invalid file: %s (line %zu)\n", file_name, error_line);
+    return INVALID_FILE;
+  }
+  else if (extraction_check == 3)
+  {
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
   }
+  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Function that connects every aspect for the game logic
+/// Opening a streamed deck, either a text config file or with "random:<cards>"
+/// a deck of random cards, 0 cards = endless. Only the ring of the draw pile
+/// and the read buffers are kept in memory, however long the deck is
 ///
-/// @param p player 
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param draw_pile command (move from player)
-/// @param curr_player current player in turn
-/// @param curr_spice spice of the round
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param cards_played_in_round cards played in round 
-/// @param last_action latest action (turn before)
-/// @param loser loser of the round
+/// @param stream streamed deck to open
+/// @param name config file or random:<cards>
+/// @param seed seed of a random deck
 ///
-/// @return 4 = Mem error; 5 = endgame(drawpile empty); 0 = Valid Play / Draw; 
-///         8 = Valid challenge; -1 = Valid quit
+/// @return 2 = file not open; 4 = alloc fail; 0 = Valid
 //
-int inputMove(Player* p, Player* p1, Player* p2, Card** draw_pile, int curr_player, char* curr_spice,
-  char** latest_played_card, char** latest_real_card, int* cards_played_in_round, int* last_action, int* loser)
+int openStreamDeck(StreamDeck* stream, char* name, uint64_t seed)
 {
-  size_t curr_char = 0;
-  size_t length = 1;
-  char* move = (char*)calloc(length, sizeof(char));
-  if (move == NULL)
+  CardSource source;
+  stream->name_ = name;
+  stream->generated_ = strncmp(name, RANDOM_DECK_PREFIX, strlen(RANDOM_DECK_PREFIX)) == 0;
+
+  if (stream->generated_)
   {
-    free(move);
-    move = NULL;
-    return 4;
+    stream->random_.seed_ = seed;
+    stream->random_.size_ = strtoull(name + strlen(RANDOM_DECK_PREFIX), NULL, 10);
+    rewindRandomCards(&stream->random_);
+    source = (CardSource){ readRandomCards, rewindRandomCards, &stream->random_ };
   }
-
-  while (true)
+  else
   {
-    printf("P%i > ", curr_player);
-    if (userInput(&move, length, &curr_char) == 4)
-    {
-      free(move);
-      move = NULL;
-      return 4;
-    }
-
-    if (isCommand(move, "swap"))
-    {
-      moveSwap(move, latest_real_card,
-        last_action, curr_player, loser, p1, p2, cards_played_in_round);
-      free(move);
-      move = NULL;
-      break;
-    }
-
-    if (!isValidMove(move, cards_played_in_round, last_action, p1, p2,
-      curr_player, latest_played_card, curr_spice))
-    {
-      curr_char = 0;
-      continue;
-    }
-    
-    if (isQuit(move, latest_played_card, latest_real_card))
-      return -1;
-
-    if (isCommand(move, "play"))
-    {
-      if (movePlay(move, latest_played_card, latest_real_card, cards_played_in_round,
-        last_action, curr_spice, curr_player, p1, p2) == 4)
-      {
-        free(move);
-        move = NULL;
-        return 4;
-      }
-    }
-    else if (isCommand(move, "challenge"))
-    {
-      moveChallenge(move, latest_played_card, latest_real_card,
-        last_action, curr_player, loser, p1, p2, cards_played_in_round);
-      free(move);
-      move = NULL;
-      return 8;
-    }
-    else if (isCommand(move, "draw"))
+    int open_check = openTextSource(&stream->text_, name);
+    if (open_check != 0)
     {
-      if (Draw(move, p, draw_pile, last_action) == 5)
-        return 5;
-      else
-        break;
+      printf(open_check == 1 ? "Error: Cannot open file: %s\n" : "Error: Out of memory\n", name);
+      return (open_check == 1) ? CANT_OPEN_FILE : ALLOC_FAIL;
     }
-
-    
-      break;
+    source = (CardSource){ readTextCards, rewindTextCards, &stream->text_ };
   }
 
-  if (move != NULL)
-    free(move);
+  if (initialisePileStream(&stream->pile_, &source) != 0)
+  {
+    if (!stream->generated_)
+      closeTextSource(&stream->text_);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
   return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Getting input from user, skipping leading spaces
+/// Closing a streamed deck
 ///
-/// @param move command (move from player)
-/// @param length bluff card from the play before
-/// @param curr_char real card from the play before
+/// @param stream streamed deck
 ///
-/// @return 4 = Mem error; 0 = Valid
+/// @return no return
 //
-int userInput(char** move, size_t length, size_t* curr_char)
+void closeStreamDeck(StreamDeck* stream)
 {
-  int input = 0;
-  bool first_non_space = false;
-
-  while ((input = getchar()) != '\n')
-  {
-    if (isspace(input) && !first_non_space)
-    {
-      continue;
-    }
-    first_non_space = true;
-
-    if (*curr_char >= length - 1)
-    {
-      length += BUFFERSIZE;
-      char* move_temp = (char*)realloc(*move, length);
-      if (move_temp == NULL)
-      {
-        return 4;
-      }
-      *move = move_temp;
-      move_temp = NULL;
-    }
-    (*move)[(*curr_char)++] = tolower(input);
-  }
-  (*move)[*curr_char] = '\0';
-
-  return 0;
+  freePileStream(&stream->pile_);
+  if (!stream->generated_)
+    closeTextSource(&stream->text_);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Compare inputed commands with commands
+/// Filling the ring of a streamed deck and dealing a new game on it
 ///
-/// @param move command (move from player)
-/// @param check compared value
+/// @param stream streamed deck at its start
+/// @param game game to initialise
 ///
-/// @return false = invalid; true = valid
+/// @return 3 = not a valid file; 0 = Valid
 //
-bool isCommand(char* move, char* check)
+int startStreamGame(StreamDeck* stream, EspGame* game)
 {
-  char command[20] = { 0 };
-  sscanf(move, "%s ", command);
-
-  if (strcmp(command, check) != 0)
-    return false;
-  return true;
+  if (refillPileStream(&stream->pile_, 0) != 0)
+  {
+    printf("Error: Invalid file: %s (line %zu)\n", stream->name_, stream->text_.line_ + 1);
+    return INVALID_FILE;
+  }
+  esp_game_init_ring(game, stream->pile_.ring_, PILE_RING_SIZE - 1, stream->pile_.written_);
+  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// If the command is quit end game
+/// Putting the next cards of a streamed deck on the draw pile of its game, so
+/// the game only runs out of cards at the true end of the deck
 ///
-/// @param move command (move from player)
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
+/// @param stream streamed deck
+/// @param game game on the deck
 ///
-/// @return false = not quit; true = is true
+/// @return 3 = not a valid file; 0 = Valid
 //
-bool isQuit(char* move, char** latest_played_card, char** latest_real_card)
+int refillStreamDeck(StreamDeck* stream, EspGame* game)
 {
-  char command[10] = { 0 };
-  sscanf(move, "%9s ", command);
-  
-  if (strcmp(command, "quit") == 0)
+  if (refillPileStream(&stream->pile_, game->state_.pile_next_) != 0)
   {
-    free(move);
-    move = NULL;
-    freeLatest(latest_played_card, latest_real_card);
-    return true;
+    printf("Error: Invalid file: %s (line %zu)\n", stream->name_, stream->text_.line_ + 1);
+    return INVALID_FILE;
   }
-  return false;
+  game->deck_size_ = stream->pile_.written_;
+  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// If the command is play, the cards get checked here
-/// and get processed for the next round
+/// Freeing the deck of a game, either loaded or streamed
 ///
-/// @param move command (move from player)
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param cards_played_in_round cards played in round
-/// @param last_action latest action (turn before)
-/// @param curr_spice spice of the round
-/// @param curr_player current player in turn
-/// @param p1 player 1
-/// @param p2 player 2
+/// @param deck loaded deck, empty when streamed
+/// @param stream streamed deck; NULL = not streamed
 ///
 /// @return no return
 //
-int movePlay(char* move, char** latest_played_card, char** latest_real_card,
-  int* cards_played_in_round, int* last_action, char* curr_spice, int curr_player, Player* p1, Player* p2)
+void freeDeck(DrawPile* deck, StreamDeck* stream)
 {
-  if (*latest_played_card != NULL && *latest_real_card != NULL)
-    freeLatest(latest_played_card, latest_real_card);
-
-  char command[10] = { 0 };
-  char real_card[10] = { 0 };
-  char played_card[10] = { 0 };
-
-  sscanf(move, "%s %s %s", command, real_card, played_card);
-  sscanf(played_card, "%*d_%c", curr_spice);
-
-  *latest_real_card = (char*)malloc(strlen(real_card) + 1);
-  if (*latest_real_card == NULL)
-  {
-    free(*latest_real_card);
-    *latest_real_card = NULL;
-    return 4;
-  }
-  strcpy(*latest_real_card, real_card);
-
-  deleteFromHand(p1, p2, curr_player, latest_real_card);
-
-  *latest_played_card = (char*)malloc(strlen(played_card) + 1);
-  if (*latest_played_card == NULL)
-  {
-    free(*latest_real_card);
-    *latest_real_card = NULL;
-    free(*latest_played_card);
-    *latest_played_card = NULL;
-    
-    return 4;
-  }
-  strcpy(*latest_played_card, played_card);
-
-  (*cards_played_in_round)++;
-  *last_action = 0;
+  freeCards(deck);
+  if (stream != NULL)
+    closeStreamDeck(stream);
+}
 
+//------------------------------------------------------------------------------
+///
+/// Card source of a random deck, see CardSource. Every card is drawn uniformly
+/// from all card kinds
+///
+/// @param context RandomDeck
+/// @param cards room for the cards
+/// @param capacity number of cards to put at most
+/// @param count cards put; 0 = end of the deck
+///
+/// @return 0 = Valid
+//
+int readRandomCards(void* context, Card* cards, size_t capacity, size_t* count)
+{
+  RandomDeck* deck = (RandomDeck*)context;
+  if (deck->size_ != 0 && capacity > deck->remaining_)
+    capacity = (size_t)deck->remaining_;
+
+  for (size_t i = 0; i < capacity; i++)
+    cards[i] = (Card)(nextRandom(&deck->state_) % CARD_KINDS);
+  deck->remaining_ -= capacity;
+  *count = capacity;
   return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Delete the real card in player hand after a move 
+/// Starting a random deck over with the same cards
 ///
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param curr_player current player in turn
-/// @param latest_real_card real card from the play before
+/// @param context RandomDeck
 ///
-/// @return no return
+/// @return 0 = Valid
 //
-void deleteFromHand(Player* p1, Player* p2, int curr_player, char** latest_real_card)
+int rewindRandomCards(void* context)
 {
-  Player* curr_p = (curr_player == 1) ? p1 : p2;
+  RandomDeck* deck = (RandomDeck*)context;
+  deck->state_ = deck->seed_ ^ 0xD1B54A32D192ED03ULL;
+  deck->remaining_ = deck->size_;
+  return 0;
+}
 
-  if (curr_p != NULL)
+//------------------------------------------------------------------------------
+///
+/// Plays a game until it ends, rendering the start of every round and every turn.
+/// @param session seats and output
+/// @param game game to play
+/// A streamed draw pile is refilled before every turn
+///
+/// @return 3 = invalid card in a streamed deck; 4 = Mem error;
+///         5 = endgame(drawpile empty); 6 = endgame(hand full);
+///         -1 = Valid quit or end of input
+//
+int gameplay(Session* session, EspGame* game)
+{
+  // a resumed game can start in the middle of a round
+  bool round_start = game->state_.cards_played_ == 0 && game->state_.last_action_ == 0;
+  while (true)
   {
-    int value_real_card = 0;
-    char spice_real_card = 0;
-    sscanf(*latest_real_card, "%d_%c", &value_real_card, &spice_real_card);
-
-    Card* curr = curr_p->hand_;
-    Card* prev = NULL;
+    STATS_POLL();
+    if (round_start)
+    {
+      PHASE_START(render);
+      renderRoundStart(session->renderer_);
+      PHASE_STOP(PHASE_RENDER, render);
+    }
 
-    while (curr != NULL)
+    if (session->stream_ != NULL)
     {
-      if ((curr->value_ == value_real_card) && (curr->spice_ == spice_real_card))
-      {
-        if (prev == NULL)
-        {
-          curr_p->hand_ = curr->next_card_;
-        }
-        else
-        {
-          prev->next_card_ = curr->next_card_;
-        }
-        free(curr);
-        curr = NULL;
-        break;
-      }
-      prev = curr;
-      curr = curr->next_card_;
+      PHASE_START(refill);
+      int refill_check = refillStreamDeck(session->stream_, game);
+      PHASE_STOP(PHASE_REFILL, refill);
+      if (refill_check != 0)
+        return INVALID_FILE;
     }
+
+    int over = esp_is_over(game);
+    if (over != 0)
+      return over;
+
+    int return_checker = turnsInGameplay(session, game);
+    if (return_checker == 4 || return_checker == -1)
+      return return_checker;
+
+    round_start = (return_checker == 8);
   }
 }
 
 //------------------------------------------------------------------------------
 ///
-/// If the command is challenge, the type of the challenge gets checked here
-/// and gets processed for the next round
+/// Function that renders the player in turn and lets the seat make a move
 ///
-/// @param move command (move from player)
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param last_action latest action (turn before)
-/// @param curr_player current player in turn
-/// @param loser loser of the round
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param cards_played cards played in round 
+/// @param session seats and output
+/// @param game game
 ///
-/// @return no return
+/// @return 4 = Mem error; 0 = Valid Play / Draw / Swap; 8 = round over; -1 = Valid quit
 //
-void moveChallenge(char* move, char** latest_played_card, char** latest_real_card, int* last_action,
-  int curr_player, int* loser, Player* p1, Player* p2, int* cards_played)
+int turnsInGameplay(Session* session, EspGame* game)
 {
-  char command[10] = { 0 };
-  char value_or_spice[10] = { 0 };
-  *last_action = 3;
-
-  sscanf(move, "%s %s", command, value_or_spice);
-
-  if (strcmp(value_or_spice, "spice") == 0)
-  {
-    compareSpices(latest_played_card, latest_real_card, curr_player, loser, p1, p2, cards_played);
-  }
-  else if (strcmp(value_or_spice, "value") == 0)
-  {
-    compareValues(latest_played_card, latest_real_card, curr_player, loser, p1, p2, cards_played);
-  }
+  int curr_turn = game->state_.curr_player_;
+  session->turns_++;
+  PHASE_START(render);
+  renderTurn(session->renderer_, curr_turn, &game->state_.players_[curr_turn - 1],
+    &game->state_.players_[2 - curr_turn], game->state_.latest_played_card_, game->state_.cards_played_);
+  PHASE_STOP(PHASE_RENDER, render);
+
+  return inputMove(session, game);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Comparing spices of the card played before the challenge
+/// Initialising a renderer. Text and events are collected in a buffer that is
+/// written out by renderFlush, nothing is allocated when the output is off
 ///
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param curr_player current player in turn
-/// @param loser loser of the round
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param cards_played cards played in round 
+/// @param renderer renderer to initialise
+/// @param mode RENDER_TEXT, RENDER_EVENTS or RENDER_OFF
+/// @param out stream the output is written to
 ///
-/// @return no return
+/// @return 4 = Mem error; 0 = Valid
 //
-void compareSpices(char** latest_played_card, char** latest_real_card, int curr_player,
-  int* loser, Player* p1, Player* p2, int* cards_played)
+int initialiseRenderer(Renderer* renderer, int mode, FILE* out)
 {
-  char spice1 = 0;
-  char spice2 = 0;
-  bool challenge_success_or_fail = false;
-  int spice = 1;
+  renderer->mode_ = mode;
+  renderer->out_ = out;
+  renderer->buffer_ = NULL;
+  renderer->length_ = 0;
 
-  sscanf(*latest_played_card, "%*d_%c", &spice1);
-  sscanf(*latest_real_card, "%*d_%c", &spice2);
+  if (mode == RENDER_OFF)
+    return 0;
 
-  if (spice1 == spice2)
-  {
-    challenge_success_or_fail = false;
-    printChallenge(latest_played_card, latest_real_card, curr_player, p1, p2,
-      challenge_success_or_fail, spice, cards_played);
-    *loser = (curr_player == 1) ? 1 : 2;
-  }
-  else
-  {
-    challenge_success_or_fail = true;
-    printChallenge(latest_played_card, latest_real_card, curr_player, p1, p2,
-      challenge_success_or_fail, spice, cards_played);
-    *loser = (curr_player == 1) ? 2 : 1;
-  }
+  renderer->buffer_ = (char*)malloc(RENDER_BUFFER_SIZE);
+  if (renderer->buffer_ == NULL)
+    return 4;
+  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Comparing values of the card played before the challenge
+/// Flushing pending output and freeing the buffer of a renderer
 ///
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param curr_player current player in turn
-/// @param loser loser of the round
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param cards_played cards played in round 
+/// @param renderer renderer
 ///
 /// @return no return
 //
-void compareValues(char** latest_played_card, char** latest_real_card, int curr_player,
-  int* loser, Player* p1, Player* p2, int* cards_played)
+void freeRenderer(Renderer* renderer)
 {
-  int value1 = 0;
-  int value2 = 0;
-  bool challenge_success_or_fail = false;
-  int value = 0;
+  renderFlush(renderer);
+  free(renderer->buffer_);
+  renderer->buffer_ = NULL;
+}
 
-  sscanf(*latest_played_card, "%d_", &value1);
-  sscanf(*latest_real_card, "%d_", &value2);
+//------------------------------------------------------------------------------
+///
+/// Writing the collected output to the stream
+///
+/// @param renderer renderer
+///
+/// @return no return
+//
+void renderFlush(Renderer* renderer)
+{
+  if (renderer->length_ == 0)
+    return;
 
-  if (value1 == value2)
-  {
-    challenge_success_or_fail = false;
-    printChallenge(latest_played_card, latest_real_card, curr_player, p1, p2,
-      challenge_success_or_fail, value, cards_played);
-    *loser = (curr_player == 1) ? 1 : 2;
-  }
-  else
-  {
-    challenge_success_or_fail = true;
-    printChallenge(latest_played_card, latest_real_card, curr_player, p1, p2,
-      challenge_success_or_fail, value, cards_played);
-    *loser = (curr_player == 1) ? 2 : 1;
-  }
+  fwrite(renderer->buffer_, 1, renderer->length_, renderer->out_);
+  renderer->length_ = 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Printing the appropriate message after a challenge
+/// Appending text to the output, the buffer is flushed when it runs full
 ///
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param curr_player current player in turn
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param challenge_successful successful or failed
-/// @param value_or_spice "spice" or "value"
-/// @param cards_played cards played in round 
+/// @param renderer renderer
+/// @param text text to append
+/// @param length length of the text
 ///
 /// @return no return
 //
-void printChallenge(char** latest_played_card, char** latest_real_card, int curr_player,
-  Player* p1, Player* p2, bool challenge_successful, int value_or_spice, int* cards_played)
+void renderText(Renderer* renderer, const char* text, size_t length)
 {
-  char* type = (value_or_spice == 0) ? "value" : "spice";
+  if (renderer->buffer_ == NULL)
+    return;
 
-  if (challenge_successful)
+  if (length > RENDER_BUFFER_SIZE - renderer->length_)
   {
-    printf("Challenge successful: %s's %s does not match the real card %s.\n",
-      *latest_played_card, type, *latest_real_card);
-
-    if (curr_player == 1)
+    renderFlush(renderer);
+    if (length > RENDER_BUFFER_SIZE)
     {
-      printf("Player 1 gets %d points.\n", *cards_played);
-      p1->points_ += *cards_played;
-    }
-    else
-    {
-      printf("Player 2 gets %d points.\n", *cards_played);
-      p2->points_ += *cards_played;
-    }
-  }
-  else
-  {
-    printf("Challenge failed: %s's %s matches the real card %s.\n",
-      *latest_played_card, type, *latest_real_card);
-
-    if (curr_player == 1)
-    {
-      printf("Player 2 gets %d points.\n", *cards_played);
-      p2->points_ += *cards_played;
-      if (p2->hand_ == NULL)
-      {
-        printf("Player 2 gets 10 bonus points (last card).\n");
-        p2->points_ += 10;
-      }
-    }
-    else
-    {
-      printf("Player 1 gets %d points.\n", *cards_played);
-      p1->points_ += *cards_played;
-      if (p1->hand_ == NULL)
-      {
-        printf("Player 1 gets 10 bonus points (last card).\n");
-        p1->points_ += 10;
-      }
+      fwrite(text, 1, length, renderer->out_);
+      return;
     }
   }
+  memcpy(renderer->buffer_ + renderer->length_, text, length);
+  renderer->length_ += length;
 }
 
-void moveSwap(char* move, char** latest_real_card, int* last_action,
-  int curr_player, int* loser, Player* p1, Player* p2, int* cards_played)
+//------------------------------------------------------------------------------
+///
+/// Appending a null terminated string to the output
+///
+/// @param renderer renderer
+/// @param text text to append
+///
+/// @return no return
+//
+void renderString(Renderer* renderer, const char* text)
 {
-  char command[10] = { 0 };
-  char real_card[10] = { 0 };
-  int index = 0;
-  char spice = 0;
-  int value = 0;
-  int value2 = 0;
-  char spice2 = 0;
-  int play2 = (curr_player == 1) ? 2 : 1;
-
-  sscanf(move, "%s %s %i", command, real_card, &index);
-  sscanf(real_card, "%i_%c", &value, &spice);
-
-  char* p1_card_delete = real_card;
-
-  Player* player = (curr_player == 1) ? p1 : p2;
-  Player* player2 = (curr_player == 1) ? p2 : p1;
-  Card* curr_p = player->hand_;
-  Card* curr_p2 = player2->hand_;
-
-  deleteFromHand(p1, p2, curr_player, &p1_card_delete);
-  //printf("%c_%i\n", spice, value);
-  
-  deleteWhenIndex(player2, index, &value2, &spice2);
-
-  Card* new_card1 = (Card*)malloc(sizeof(Card));
-  new_card1->value_ = value2;
-  new_card1->spice_ = spice2;
-  new_card1->next_card_ = NULL;
-  while (curr_p->next_card_ != NULL)
-  {
-    curr_p = curr_p->next_card_;
-  }
-  curr_p->next_card_ = new_card1;
-
-  Card* new_card2 = (Card*)malloc(sizeof(Card));
-  new_card2->value_ = value;
-  new_card2->spice_ = spice;
-  new_card2->next_card_ = NULL;
-  while (curr_p2->next_card_ != NULL)
-  {
-    curr_p2 = curr_p2->next_card_;
-  }
-  curr_p2->next_card_ = new_card2;
-
-  sortPlayerHand(p1);
-  sortPlayerHand(p2);
+  renderText(renderer, text, strlen(text));
 }
 
-void deleteWhenIndex(Player* curr_p, int index, int* value, char* spice)
+//------------------------------------------------------------------------------
+///
+/// Appending a decimal number to the output
+///
+/// @param renderer renderer
+/// @param number number to append
+///
+/// @return no return
+//
+void renderNumber(Renderer* renderer, int number)
 {
-  int count = 0;
-  Card* curr = curr_p->hand_;
-  Card* prev = NULL;
+  char digits[12];
+  size_t position = sizeof(digits);
+  unsigned int magnitude = (number < 0) ? 0u - (unsigned int)number : (unsigned int)number;
 
-  while (curr != NULL)
+  do
   {
-    if (count == index)
-    {
-      *value = curr->value_;
-      *spice = curr->spice_;
-      if (prev == NULL)
-      {
-        curr_p->hand_ = curr->next_card_;
-      }
-      else
-      {
-        prev->next_card_ = curr->next_card_;
-      }
-      free(curr);
-      curr = NULL;
-      break;
-    }
-    prev = curr;
-    curr = curr->next_card_;
-    count++;
-  }
+    digits[--position] = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (number < 0)
+    digits[--position] = '-';
+
+  renderText(renderer, digits + position, sizeof(digits) - position);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Loser draws two cards
+/// Appending a card like 3_c from the table of card names, NO_CARD is a -
 ///
-/// @param draw_pile draw pile
-/// @param p player
+/// @param renderer renderer
+/// @param card card to append
 ///
-/// @return 5 = empty draw pile; 0 = successful draw
+/// @return no return
 //
-int drawTwoCards(Card** draw_pile, Player* p)
+void renderCard(Renderer* renderer, Card card)
 {
-  for (int i = 0; i < 2; i++)
-  {
-    if (addDrawedCard(p, draw_pile) == 5)
-      return 5;
-  }
-
-  sortPlayerHand(p);
-  return 0;
+  static const char CARD_NAMES[CARD_KINDS][5] = {
+    "1_c", "2_c", "3_c", "4_c", "5_c", "6_c", "7_c", "8_c", "9_c", "10_c",
+    "1_p", "2_p", "3_p", "4_p", "5_p", "6_p", "7_p", "8_p", "9_p", "10_p",
+    "1_w", "2_w", "3_w", "4_w", "5_w", "6_w", "7_w", "8_w", "9_w", "10_w"
+  };
+
+  if (card >= CARD_KINDS)
+    renderText(renderer, "-", 1);
+  else
+    renderText(renderer, CARD_NAMES[card], (cardValue(card) == 10) ? 4 : 3);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Winner with empty hand draws six cards
+/// Greeting at the start of an interactive game, text only
 ///
-/// @param draw_pile draw pile
-/// @param p player
+/// @param renderer renderer
 ///
-/// @return 5 = empty draw pile; 0 = successful draw
+/// @return no return
 //
-int drawSixCards(Card** draw_pile, Player* p)
+void renderWelcome(Renderer* renderer)
 {
-  for (int i = 0; i < 6; i++)
-  {
-    if (addDrawedCard(p, draw_pile) == 5)
-      return 5;
-  }
-
-  sortPlayerHand(p);
-  return 0;
+  if (renderer->mode_ == RENDER_TEXT)
+    renderString(renderer, "Welcome to Entertaining Spice Pretending!\n");
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Allocating and copying the card from the current turn so we can use it to check
-/// the next turn
+/// Start of a new round
 ///
-/// @param latest_played_card bluff card from the play before
-/// @param latest_real_card real card from the play before
-/// @param played_card bluff card from the current play
-/// @param real_card real card from the current play
+/// @param renderer renderer
 ///
-/// @return false = memory error; true = successful allocation
+/// @return no return
 //
-bool allocateCards(char** latest_played_card, char** latest_real_card,
-  char* played_card, char* real_card)
+void renderRoundStart(Renderer* renderer)
 {
-  if (*latest_played_card != NULL)
-  {
-    free(*latest_played_card);
-    }
-  if (*latest_real_card != NULL)
-  {
-    free(*latest_real_card);
-  }
-
-  *latest_played_card = (char*)malloc(strlen(played_card) + 1);
-  if (*latest_played_card == NULL)
-  {
-    free(*latest_played_card);
-    return false;
-  }
-  *latest_real_card = (char*)malloc(strlen(real_card) + 1);
-  if (*latest_real_card == NULL)
-  {
-    free(*latest_real_card);
-    return false;
-  }
-  strcpy(*latest_played_card, played_card);
-  strcpy(*latest_real_card, real_card);
-
-  return true;
+  if (renderer->mode_ == RENDER_TEXT)
+    renderString(renderer, "\n-------------------\nROUND START\n-------------------\n");
+  else if (renderer->mode_ == RENDER_EVENTS)
+    renderString(renderer, "round\n");
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking input and printing the appropriate error messages for invalid input 
+/// Infos and hand of the player in turn. As event:
+/// turn <player> <latest played card> <cards played> <opponent cards> <hand cards>
 ///
-/// @param move command (move from player)
-/// @param cards_played cards played in round
-/// @param last_action latest action
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param curr_player player that is playing this turn
-/// @param latest_played_card latest card played
-/// @param curr_spice spice of the round
+/// @param renderer renderer
+/// @param curr_player current player in turn
+/// @param p player in turn
+/// @param opponent other player
+/// @param latest_played_card bluff card from the play before
+/// @param cards_played_in_round cards played in round 
 ///
-/// @return false = invalid; true = valid
+/// @return no return
 //
-bool isValidMove(char* move, int* cards_played, int* last_action, Player* p1, Player* p2,
-  int curr_player, char** latest_played_card, char* curr_spice)
+void renderTurn(Renderer* renderer, int curr_player, Player* p, Player* opponent,
+  Card latest_played_card, int cards_played_in_round)
 {
-  int parameter_count = parameterCounter(move);
-  Player* player = (curr_player == 1) ? p1 : p2;
+  if (renderer->mode_ == RENDER_OFF)
+    return;
 
-  if (!isCommandValid(move))
-  {
-    printf("Please enter a valid command!\n");
-    return false;
-  }
-  else if (!isParameterValid(move, parameter_count))
-  {
-    printf("Please enter the correct number of parameters!\n");
-    return false;
-  }
-  else if (!isCommandTimedRight(move, cards_played, last_action, p1, p2, curr_player))
-  {
-    printf("Please enter a command you can use at the moment!\n");
-    return false;
-  }
-  else if (strncmp(move, "play", 4) == 0 && !isFormatValid(move))
-  {
-    printf("Please enter the cards in the correct format!\n");
-    return false;
-  }
-  else if (strncmp(move, "play", 4) == 0 && !isInHand(move, player))
-  {
-    printf("Please enter a card in your hand cards!\n");
-    return false;
-  }
-  else if (strncmp(move, "play", 4) == 0 && !isValidCurrentPlay(move, cards_played, latest_played_card, curr_spice))
-  {
-    return false;
-  }
-  else if (strncmp(move, "challenge", 9) == 0 && !isValidChallengeType(move))
+  if (renderer->mode_ == RENDER_EVENTS)
   {
-    printf("Please choose SPICE or VALUE!\n");
-    return false;
+    renderString(renderer, "turn ");
+    renderNumber(renderer, curr_player);
+    renderText(renderer, " ", 1);
+    renderCard(renderer, latest_played_card);
+    renderText(renderer, " ", 1);
+    renderNumber(renderer, cards_played_in_round);
+    renderText(renderer, " ", 1);
+    renderNumber(renderer, handSize(&opponent->hand_));
   }
-  else if (strncmp(move, "swap", 4) == 0 && !isValidSwap(move, curr_player, p1, p2))
+  else
   {
-    printf("Index out of bounds!");
-    return false;
+    renderString(renderer, "\nPlayer ");
+    renderNumber(renderer, curr_player);
+    renderString(renderer, ":\n    latest played card:");
+    if (latest_played_card != NO_CARD || handIsEmpty(&opponent->hand_))
+    {
+      renderText(renderer, " ", 1);
+      renderCard(renderer, latest_played_card);
+    }
+    if (handIsEmpty(&opponent->hand_))
+      renderString(renderer, " LAST CARD");
+    renderString(renderer, "\n    cards played this round: ");
+    renderNumber(renderer, cards_played_in_round);
+    renderString(renderer, "\n    hand cards:");
   }
 
-  return true;
-}
-
-bool isValidSwap(char* move, int curr_player, Player* p1, Player* p2)
-{
-  char command[10] = { 0 };
-  char real_card[10] = { 0 };
-  int index = 0;
-  int count = 0;
-  sscanf(move, "%9s %6s %9i", command, real_card, &index);
-
-  Card* curr = (curr_player == 1) ? p2->hand_ : p1->hand_;
-  while (curr != NULL)
+  uint32_t present = handPresent(&p->hand_);
+  while (present != 0)
   {
-    count++;
-    curr = curr->next_card_;
+    Card card = (Card)__builtin_ctz(present);
+    for (int copy = handCount(&p->hand_, card); copy > 0; copy--)
+    {
+      renderText(renderer, " ", 1);
+      renderCard(renderer, card);
+    }
+    present &= present - 1;
   }
+  renderText(renderer, "\n", 1);
+}
 
-  if (count > index)
-    return false;
+//------------------------------------------------------------------------------
+///
+/// Prompt of a human player, flushed right away so it shows before the input
+///
+/// @param renderer renderer
+/// @param curr_player current player in turn
+///
+/// @return no return
+//
+void renderPrompt(Renderer* renderer, int curr_player)
+{
+  if (renderer->mode_ == RENDER_OFF)
+    return;
 
-  return true;
+  renderString(renderer, (renderer->mode_ == RENDER_TEXT) ? "P" : "prompt ");
+  renderNumber(renderer, curr_player);
+  renderString(renderer, (renderer->mode_ == RENDER_TEXT) ? " > " : "\n");
+  renderFlush(renderer);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Calculating parameters
+/// Accepted move of a player, events only:
+/// play <player> <real card> <played card>, draw <player>,
+/// challenge <player> <spice|value>, swap <player> <card> <index>, quit <player>
 ///
-/// @param move command (move from player)
+/// @param renderer renderer
+/// @param curr_player current player in turn
+/// @param move parsed move
 ///
-/// @return number of parameters
+/// @return no return
 //
-int parameterCounter(char* move)
+void renderMove(Renderer* renderer, int curr_player, Move* move)
 {
-  int count = 0;
-  bool word = false;
+  static const char* const MOVE_NAMES[] = { "invalid ", "play ", "draw ", "challenge ", "swap ", "quit " };
+
+  if (renderer->mode_ != RENDER_EVENTS)
+    return;
 
-  while (*move != '\0')
+  renderString(renderer, MOVE_NAMES[move->kind_]);
+  renderNumber(renderer, curr_player);
+  if (move->kind_ == MOVE_PLAY || move->kind_ == MOVE_SWAP)
   {
-    if (!isspace(*move))
-    {
-      if (!word)
-      {
-        count++;
-        word = true;
-      }
-    }
+    renderText(renderer, " ", 1);
+    renderCard(renderer, move->real_card_);
+    renderText(renderer, " ", 1);
+    if (move->kind_ == MOVE_PLAY)
+      renderCard(renderer, move->played_card_);
     else
-    {
-      word = false;
-    }
-    move++;
+      renderNumber(renderer, move->swap_index_);
   }
+  else if (move->kind_ == MOVE_CHALLENGE)
+  {
+    renderString(renderer, (move->challenge_ == CHALLENGE_SPICE) ? " spice" : " value");
+  }
+  renderText(renderer, "\n", 1);
+}
 
-  return count;
+//------------------------------------------------------------------------------
+///
+/// Error message for an invalid move. As event: error <reason>
+///
+/// @param renderer renderer
+/// @param error ERROR_*
+///
+/// @return no return
+//
+void renderError(Renderer* renderer, int error)
+{
+  static const char* const ERROR_TEXTS[] = {
+    "",
+    "Please enter a valid command!\n",
+    "Please enter the correct number of parameters!\n",
+    "Please enter a command you can use at the moment!\n",
+    "Please enter the cards in the correct format!\n",
+    "Please enter a card in your hand cards!\n",
+    "Please enter a valid VALUE!\n",
+    "Please enter a valid SPICE!\n",
+    "Please choose SPICE or VALUE!\n",
+    "Index out of bounds!\n"
+  };
+  static const char* const ERROR_EVENTS[] = {
+    "", "error command\n", "error parameters\n", "error timing\n", "error format\n", "error hand\n",
+    "error value\n", "error spice\n", "error challenge\n", "error index\n"
+  };
+
+  if (renderer->mode_ == RENDER_TEXT)
+    renderString(renderer, ERROR_TEXTS[error]);
+  else if (renderer->mode_ == RENDER_EVENTS)
+    renderString(renderer, ERROR_EVENTS[error]);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the command has valid number of parameters
+/// Revealed card of a challenge. As event:
+/// reveal <played card> <real card> <spice|value> <success|fail>
 ///
-/// @param move command (move from player)
-/// @param parameter_count parameters from move
+/// @param renderer renderer
+/// @param latest_played_card bluff card from the play before
+/// @param latest_real_card real card from the play before
+/// @param challenge CHALLENGE_SPICE or CHALLENGE_VALUE
+/// @param challenge_successful successful or failed
 ///
-/// @return false = invalid; true = valid
+/// @return no return
 //
-bool isParameterValid(char* move, int parameter_count)
+void renderChallenge(Renderer* renderer, Card latest_played_card, Card latest_real_card,
+  int challenge, bool challenge_successful)
 {
-  char command[10] = { 0 };
-  sscanf(move, "%9s", command);
+  char* type = (challenge == CHALLENGE_SPICE) ? "spice" : "value";
 
-  if (strcmp(command, "quit") == 0 && parameter_count > 1)
-  {
-    return false;
-  }
-  else if (strcmp(command, "draw") == 0 && parameter_count > 1)
+  if (renderer->mode_ == RENDER_TEXT)
   {
-    return false;
+    renderString(renderer, challenge_successful ? "Challenge successful: " : "Challenge failed: ");
+    renderCard(renderer, latest_played_card);
+    renderString(renderer, "'s ");
+    renderString(renderer, type);
+    renderString(renderer, challenge_successful ? " does not match the real card " :
+      " matches the real card ");
+    renderCard(renderer, latest_real_card);
+    renderString(renderer, ".\n");
   }
-  else if (strcmp(command, "challenge") == 0 && parameter_count != 2)
+  else if (renderer->mode_ == RENDER_EVENTS)
   {
-    return false;
+    renderString(renderer, "reveal ");
+    renderCard(renderer, latest_played_card);
+    renderText(renderer, " ", 1);
+    renderCard(renderer, latest_real_card);
+    renderText(renderer, " ", 1);
+    renderString(renderer, type);
+    renderString(renderer, challenge_successful ? " success\n" : " fail\n");
   }
-  else if (strcmp(command, "play") == 0 && parameter_count != 3)
-  {
-    return false;
-  }
-  return true;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the commands are overall valid
+/// Points awarded to a player. As event: points <player> <points>
+/// or bonus <player> <points>
 ///
-/// @param move command (move from player)
+/// @param renderer renderer
+/// @param player player getting the points
+/// @param points number of points
+/// @param bonus true = bonus for the last card
 ///
-/// @return false = invalid; true = valid
+/// @return no return
 //
-bool isCommandValid(char* move)
+void renderPoints(Renderer* renderer, int player, int points, bool bonus)
 {
-  char command[10] = { 0 };
-  sscanf(move, "%9s", command);
-
-  if (strcmp(command, "quit") == 0 || strcmp(command, "draw") == 0 ||
-    strcmp(command, "play") == 0 || strcmp(command, "challenge") == 0)
+  if (renderer->mode_ == RENDER_TEXT)
   {
-    return true;
+    renderString(renderer, "Player ");
+    renderNumber(renderer, player);
+    renderString(renderer, " gets ");
+    renderNumber(renderer, points);
+    renderString(renderer, bonus ? " bonus points (last card).\n" : " points.\n");
+  }
+  else if (renderer->mode_ == RENDER_EVENTS)
+  {
+    renderString(renderer, bonus ? "bonus " : "points ");
+    renderNumber(renderer, player);
+    renderText(renderer, " ", 1);
+    renderNumber(renderer, points);
+    renderText(renderer, "\n", 1);
   }
-
-  return false;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the commands are valid for the turn
+/// Asks the seat in turn for moves until one is legal, makes it and renders it
 ///
-/// @param move command (move from player)
-/// @param cards_played cards played in round
-/// @param last_action latest action
-/// @param p1 player 1
-/// @param p2 player 2
-/// @param curr_player player that is playing this turn
+/// @param session seats and output
+/// @param game game
 ///
-/// @return false = invalid; true = valid
+/// @return 4 = Mem error; 0 = Valid Play / Draw / Swap; 8 = round over; 
+///         -1 = Valid quit or end of input
 //
-bool isCommandTimedRight(char* move, int* cards_played, int* last_action,
-  Player* p1, Player* p2, int curr_player)
+int inputMove(Session* session, EspGame* game)
 {
-  char command[10] = { 0 };
-  sscanf(move, "%9s ", command);
+  int curr_player = game->state_.curr_player_;
+  Seat* seat = &session->seats_[curr_player - 1];
+  TurnView view = { &game->state_.players_[curr_player - 1], &game->state_.players_[2 - curr_player], curr_player,
+    game->state_.cards_played_, game->state_.last_action_, game->state_.curr_spice_, game->state_.latest_played_card_,
+    game };
 
-  if (strcmp(command, "challenge") == 0 && *cards_played == 0)
-  {
-    return false;
-  }
-  else if (strcmp(command, "challenge") == 0 && (*last_action == 1 || *last_action == 2))
-  {
-    return false;
-  }
-  else if (strcmp(command, "play") == 0 || strcmp(command, "draw") == 0)
+  while (true)
   {
-    Player* player = (curr_player == 1) ? p2 : p1;
-    if (player->hand_ == NULL)
+    char* line = NULL;
+    PHASE_START(input);
+    int provide_checker = seat->provide_(seat->context_, &view, &line);
+    PHASE_STOP(PHASE_INPUT, input);
+    if (provide_checker != 0)
+      return provide_checker;
+    if (session->record_ != NULL)
+      fprintf(session->record_, "%s\n", line);
+
+    Move move;
+    PHASE_START(parse);
+    parseMove(line, &move);
+    PHASE_STOP(PHASE_PARSE, parse);
+
+    EspOutcome outcome;
+    PHASE_START(apply);
+    int error = esp_apply(game, &move, &outcome);
+    PHASE_STOP(PHASE_APPLY, apply);
+    PHASE_START(render);
+    if (error != ERROR_NONE)
     {
-      return false;
+      renderError(session->renderer_, error);
+      PHASE_STOP(PHASE_RENDER, render);
+      continue;
     }
-  }
+    renderMove(session->renderer_, curr_player, &move);
+
+    if (outcome.challenge_ != CHALLENGE_NONE && session->stats_ != NULL)
+    {
+      session->stats_->challenges_[outcome.challenge_]++;
+      session->stats_->successes_[outcome.challenge_] += outcome.challenge_successful_ ? 1 : 0;
+    }
+    if (outcome.challenge_ != CHALLENGE_NONE)
+    {
+      renderChallenge(session->renderer_, outcome.played_card_, outcome.real_card_, outcome.challenge_,
+        outcome.challenge_successful_);
+      renderPoints(session->renderer_, outcome.scorer_, outcome.points_, false);
+      if (outcome.bonus_ != 0)
+        renderPoints(session->renderer_, outcome.scorer_, outcome.bonus_, true);
+    }
+    PHASE_STOP(PHASE_RENDER, render);
 
-  return true;
+    if (move.kind_ == MOVE_QUIT)
+      return -1;
+    return outcome.round_over_ ? 8 : 0;
+  }
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the input format is valid for command "play"
+/// Move provider for a human player: prompts and reads the move from the input,
+/// skipping leading spaces and converting it to lowercase
 ///
-/// @param move command (move from player)
+/// @param context HumanSeat with the input and the renderer for the prompt
+/// @param view state of the turn
+/// @param line move line
 ///
-/// @return false = invalid; true = valid
+/// @return 4 = Mem error; -1 = end of input; 0 = Valid
 //
-bool isFormatValid(char* move)
+int humanMove(void* context, TurnView* view, char** line)
 {
-  char command[10] = { 0 };
-  char real_card[10] = { 0 };
-  char played_card[10] = { 0 };
-  sscanf(move, "%9s %5s %5s", command, real_card, played_card);
-
+  HumanSeat* human = (HumanSeat*)context;
 
-  int value_real_card = 0;
-  char sign_real_card = 0;
-  char spice_real_card = 0;
-  sscanf(real_card, "%d%c%c", &value_real_card, &sign_real_card, &spice_real_card);
-
-  int value_played_card = 0;
-  char sign_played_card = 0;
-  char spice_played_card = 0;
-  sscanf(played_card, "%d%c%c", &value_played_card, &sign_played_card, &spice_played_card);
-
-  if ((value_played_card == 10 && strlen(played_card) != 4) ||
-      (value_real_card == 10 && strlen(real_card) != 4) ||
-      (value_played_card < 10 && strlen(played_card) != 3) ||
-      (value_real_card < 10 && strlen(real_card) != 3))
-  {
-    return false;
-  }
+  renderPrompt(human->renderer_, view->curr_player_);
+  if (readLine(human->input_, line) != 0)
+    return QUIT;
 
-  if ((value_real_card > 10 || value_real_card < 1) || (sign_real_card != '_') ||
-      (spice_real_card != 'c' && spice_real_card != 'p' && spice_real_card != 'w') ||
-      (value_played_card > 10 || value_played_card < 1) || (sign_played_card != '_') ||
-      (spice_played_card != 'c' && spice_played_card != 'p' && spice_played_card != 'w') ||
-      (real_card[0] == '+' || played_card[0] == '+'))
-  {
-    return false;
-  }
+  while (isspace((unsigned char)**line))
+    (*line)++;
+  for (char* input_char = *line; *input_char != '\0'; input_char++)
+    *input_char = (char)tolower((unsigned char)*input_char);
 
-  return true;
+  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the the real card played is in hand of the player
+/// Move provider for a bot choosing randomly between valid plays, draws and
+/// challenges. Plays honestly when a matching card is in hand, bluffs otherwise
 ///
-/// @param move command (move from player)
-/// @param p player
+/// @param context RandomBot state
+/// @param view state of the turn
+/// @param line move line, written to the bots move buffer
 ///
-/// @return false = not in hand; true = in hand
+/// @return 0 = Valid
 //
-bool isInHand(char* move, Player* p)
+int randomMove(void* context, TurnView* view, char** line)
 {
-  char command[10] = { 0 };
-  char real_card[10] = { 0 };
-  sscanf(move, "%s %s", command, real_card);
+  RandomBot* bot = (RandomBot*)context;
+  char* move = bot->move_;
+  *line = move;
+
+  bool can_challenge = view->cards_played_ > 0 && view->last_action_ != 1 && view->last_action_ != 2;
+  uint64_t roll = nextRandom(&bot->state_) % 8;
+
+  if (can_challenge && (handIsEmpty(&view->opponent_->hand_) || roll < 2))
+  {
+    snprintf(move, BOT_MOVE_SIZE, "challenge %s", (roll % 2 == 0) ? "spice" : "value");
+    return 0;
+  }
+  if (roll == 2 || handIsEmpty(&view->self_->hand_))
+  {
+    snprintf(move, BOT_MOVE_SIZE, "draw");
+    return 0;
+  }
+
+  int latest_value = (view->cards_played_ > 0) ? cardValue(view->latest_played_card_) : 0;
 
-  int value_real_card = 0;
-  char spice_real_card = 0;
-  sscanf(real_card, "%d_%c", &value_real_card, &spice_real_card);
+  Hand* hand = &view->self_->hand_;
+  Card real = handNth(hand, (int)(nextRandom(&bot->state_) % (uint64_t)handSize(hand)));
 
-  Card* curr = p->hand_;
-  while (curr != NULL)
+  int low = (view->cards_played_ == 0 || latest_value == 10) ? 1 : latest_value + 1;
+  int high = (view->cards_played_ == 0 || latest_value == 10) ? 3 : 10;
+  char spice = (view->cards_played_ == 0) ? cardSpice(real) : view->curr_spice_;
+
+  for (int value = low; value <= high; value++)
   {
-    if (value_real_card == curr->value_ && spice_real_card == curr->spice_)
+    if (handCount(hand, makeCard(value, spice)) > 0)
     {
-      return true;
+      real = makeCard(value, spice);
+      break;
     }
-    curr = curr->next_card_;
   }
 
-  return false;
+  int value = (cardSpice(real) == spice && cardValue(real) >= low && cardValue(real) <= high) ?
+    cardValue(real) : low + (int)(nextRandom(&bot->state_) % (uint64_t)(high - low + 1));
+  snprintf(move, BOT_MOVE_SIZE, "play %d_%c %d_%c", cardValue(real), cardSpice(real), value, spice);
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Next number of a splitmix64 generator
+///
+/// @param state generator state
+///
+/// @return random number
+//
+uint64_t nextRandom(uint64_t* state)
+{
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the input after command: "play" is valid
+/// Initialising a line reader on a file descriptor
 ///
-/// @param move command (move from player)
-/// @param cards_played cards played in round
-/// @param latest_played_card latest played card
-/// @param curr_spice spice of the round
+/// @param reader reader to initialise
+/// @param fd file descriptor to read from
 ///
-/// @return false = invalid; true = valid
+/// @return 4 = Mem error; 0 = Valid
 //
-bool isValidCurrentPlay(char* move, int* cards_played, char** latest_played_card, char* curr_spice)
+int initialiseLineReader(LineReader* reader, int fd)
 {
-  char command[10] = { 0 };
-  char played_card[10] = { 0 };
-  sscanf(move, "%9s %*s %5s", command, played_card);
+  reader->buffer_ = (char*)malloc(READ_CHUNK + 1);
+  if (reader->buffer_ == NULL)
+    return 4;
+  reader->fd_ = fd;
+  reader->start_ = 0;
+  reader->end_ = 0;
+  reader->discard_ = false;
+  reader->eof_ = false;
+  return 0;
+}
 
-  int value_played_card = 0;
-  char spice_played_card = 0;
-  sscanf(played_card, "%d_%c", &value_played_card, &spice_played_card);
+//------------------------------------------------------------------------------
+///
+/// Freeing the buffer of a line reader
+///
+/// @param reader line reader
+///
+/// @return no return
+//
+void freeLineReader(LineReader* reader)
+{
+  free(reader->buffer_);
+  reader->buffer_ = NULL;
+}
 
-  if (*cards_played == 0)
-  {
-    if (value_played_card > 3)
-    {
-      printf("Please enter a valid VALUE!\n");
-      return false;
-    }
-  }
-  else
+//------------------------------------------------------------------------------
+///
+/// Handing out the next line without the newline. The line stays in the
+/// readers buffer and is valid until the next call. Lines longer than
+/// LINE_LENGTH_MAX are cut off, the rest of them is skipped.
+/// Pending output is flushed before blocking on the fd, so prompts show up
+///
+/// @param reader line reader
+/// @param line next line
+///
+/// @return 1 = end of input; 0 = Valid
+//
+int readLine(LineReader* reader, char** line)
+{
+  while (true)
   {
-    int latest_value = 0;
-    char latest_spice = 0;
-    sscanf(*latest_played_card, "%d_%c", &latest_value, &latest_spice);
+    char* begin = reader->buffer_ + reader->start_;
+    size_t pending = reader->end_ - reader->start_;
+    char* newline = (char*)memchr(begin, '\n', pending);
 
-    if (latest_value == 10)
+    if (reader->discard_)
     {
-      if (value_played_card > 3 || value_played_card < 1)
+      if (newline != NULL || reader->eof_)
       {
-        printf("Please enter a valid VALUE!\n");
-        return false;
+        reader->start_ = (newline == NULL) ? reader->end_ : (size_t)(newline + 1 - reader->buffer_);
+        reader->discard_ = false;
+        continue;
       }
+      reader->start_ = reader->end_;
     }
-    else
+    else if (newline != NULL && newline - begin <= LINE_LENGTH_MAX)
     {
-      if (latest_value >= value_played_card)
-      {
-        printf("Please enter a valid VALUE!\n");
-        return false;
-      }
+      *newline = '\0';
+      *line = begin;
+      reader->start_ += (size_t)(newline - begin) + 1;
+      return 0;
     }
-    
-    if (*curr_spice != spice_played_card)
+    else if (pending > LINE_LENGTH_MAX)
     {
-      printf("Please enter a valid SPICE!\n");
-      return false;
+      begin[LINE_LENGTH_MAX] = '\0';
+      *line = begin;
+      reader->start_ += LINE_LENGTH_MAX + 1;
+      reader->discard_ = true;
+      return 0;
+    }
+    else if (reader->eof_)
+    {
+      if (pending == 0)
+        return 1;
+      begin[pending] = '\0';
+      *line = begin;
+      reader->start_ = reader->end_;
+      return 0;
     }
 
+    memmove(reader->buffer_, reader->buffer_ + reader->start_, reader->end_ - reader->start_);
+    reader->end_ -= reader->start_;
+    reader->start_ = 0;
+
+    fflush(stdout);
+    ssize_t bytes = read(reader->fd_, reader->buffer_ + reader->end_, READ_CHUNK - reader->end_);
+    if (bytes < 0 && errno == EINTR)
+    {
+      STATS_POLL(); // SIGUSR1 while waiting for input
+      continue;
+    }
+    if (bytes <= 0)
+      reader->eof_ = true;
+    else
+      reader->end_ += (size_t)bytes;
   }
-  
-  return true;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Checking if the challenges type is spice or value 
+/// Tokenizing a move line once into its command, cards, challenge type and
+/// swap index. Words are separated by whitespace, every word gets counted
 ///
-/// @param move command (move from player)
+/// @param line lowercase move line
+/// @param move parsed move
 ///
-/// @return false = invalid; true = valid
+/// @return no return
 //
-bool isValidChallengeType(char* move)
+void parseMove(char* line, Move* move)
 {
-  char command[10] = { 0 };
-  char type[10] = { 0 };
-  sscanf(move, "%9s %6s", command, type);
-
-  if (strcmp(type, "spice") == 0 || strcmp(type, "value") == 0)
+  move->kind_ = MOVE_INVALID;
+  move->parameters_ = 0;
+  move->real_card_ = NO_CARD;
+  move->played_card_ = NO_CARD;
+  move->challenge_ = CHALLENGE_NONE;
+  move->swap_index_ = 0;
+
+  char* word = line;
+  while (true)
   {
-    return true;
-  }
+    while (isspace((unsigned char)*word))
+      word++;
+    if (*word == '\0')
+      break;
+
+    char* end = word;
+    while (*end != '\0' && !isspace((unsigned char)*end))
+      end++;
+    size_t length = (size_t)(end - word);
+
+    if (move->parameters_ == 0)
+    {
+      if (length == 4 && memcmp(word, "play", 4) == 0)
+        move->kind_ = MOVE_PLAY;
+      else if (length == 4 && memcmp(word, "draw", 4) == 0)
+        move->kind_ = MOVE_DRAW;
+      else if (length == 9 && memcmp(word, "challenge", 9) == 0)
+        move->kind_ = MOVE_CHALLENGE;
+      else if (length == 4 && memcmp(word, "swap", 4) == 0)
+        move->kind_ = MOVE_SWAP;
+      else if (length == 4 && memcmp(word, "quit", 4) == 0)
+        move->kind_ = MOVE_QUIT;
+    }
+    else if (move->parameters_ == 1 && move->kind_ == MOVE_CHALLENGE)
+    {
+      if (length == 5 && memcmp(word, "spice", 5) == 0)
+        move->challenge_ = CHALLENGE_SPICE;
+      else if (length == 5 && memcmp(word, "value", 5) == 0)
+        move->challenge_ = CHALLENGE_VALUE;
+    }
+    else if (move->parameters_ == 1)
+    {
+      move->real_card_ = parseCard(word, length);
+    }
+    else if (move->parameters_ == 2 && move->kind_ == MOVE_SWAP)
+    {
+      move->swap_index_ = (int)strtol(word, NULL, 0);
+    }
+    else if (move->parameters_ == 2)
+    {
+      move->played_card_ = parseCard(word, length);
+    }
 
-  return false;
+    if (move->parameters_ < UINT8_MAX)
+      move->parameters_++;
+    word = end;
+  }
 }
 
 //------------------------------------------------------------------------------
 ///
-/// If the command was "draw" => add card to hand after command: draw
-/// and update last_action
+/// Parsing a single card word like 3_c or 10_w
 ///
-/// @param move command (move from player)
-/// @param p player
-/// @param draw_pile draw pile
-/// @param last_action latest action (0||1||2)
+/// @param word start of the word
+/// @param length length of the word
 ///
-/// @return 5 = empty draw_pile; 0 = successfully drawed
+/// @return card; NO_CARD = not a card
 //
-int Draw(char* move, Player* p, Card** draw_pile, int* last_action)
+Card parseCard(char* word, size_t length)
 {
-  if (addDrawedCard(p, draw_pile) == 5)
-  {
-    free(move);
-    move = NULL;
-    return 5;
-  }
-  sortPlayerHand(p);
-  *last_action = 1;
-  return 0;
+  int value = 0;
+  if (length == 3 && word[0] >= '1' && word[0] <= '9')
+    value = word[0] - '0';
+  else if (length == 4 && word[0] == '1' && word[1] == '0')
+    value = 10;
+  else
+    return NO_CARD;
+
+  if (word[length - 2] != '_')
+    return NO_CARD;
+
+  return makeCard(value, word[length - 1]);
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Add card to hand after command: draw
+/// Writing a move as the line parseMove reads
 ///
-/// @param p player that is drawing
-/// @param draw_pile draw pile
+/// @param move legal move
+/// @param line BOT_MOVE_SIZE bytes to write
 ///
-/// @return 5 = empty draw_pile; 0 = successfully drawed
+/// @return no return
 //
-int addDrawedCard(Player* p, Card** draw_pile)
+void formatMove(Move* move, char* line)
 {
-  if (*draw_pile == NULL)
-  {
-    return 5; // Draw pile empty
-  }
-
-  Card* card_to_add = *draw_pile;
-  *draw_pile = card_to_add->next_card_;
-
-  card_to_add->next_card_ = NULL;
-
-  if (p->hand_ == NULL)
-  {
-    p->hand_ = card_to_add;
-  }
-  else
+  switch (move->kind_)
   {
-    Card* curr = p->hand_;
-    while (curr->next_card_ != NULL)
-    {
-      curr = curr->next_card_;
-    }
-    curr->next_card_ = card_to_add;
+    case MOVE_PLAY:
+      snprintf(line, BOT_MOVE_SIZE, "play %d_%c %d_%c", cardValue(move->real_card_), cardSpice(move->real_card_),
+        cardValue(move->played_card_), cardSpice(move->played_card_));
+      break;
+    case MOVE_DRAW:
+      snprintf(line, BOT_MOVE_SIZE, "draw");
+      break;
+    case MOVE_CHALLENGE:
+      snprintf(line, BOT_MOVE_SIZE, "challenge %s", (move->challenge_ == CHALLENGE_SPICE) ? "spice" : "value");
+      break;
+    case MOVE_SWAP:
+      snprintf(line, BOT_MOVE_SIZE, "swap %d_%c %d", cardValue(move->real_card_), cardSpice(move->real_card_),
+        move->swap_index_);
+      break;
+    default:
+      snprintf(line, BOT_MOVE_SIZE, "quit");
+      break;
   }
-
-  return 0;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Print results
+/// Final points and the winner. As event: result <points player 1> <points player 2>
 ///
+/// @param renderer renderer
 /// @param p1 player 1
 /// @param p2 player 2
 ///
 /// @return no return
 //
-void printResults(Player* p1, Player* p2)
+void renderResults(Renderer* renderer, Player* p1, Player* p2)
 {
-  if (p1->points_ >= p2->points_ )
-  {
-    printf("\nPlayer 1: %i points\n", p1->points_);
-    printf("Player 2: %i points\n\n", p2->points_);
-  }
-  else
+  if (renderer->mode_ == RENDER_EVENTS)
   {
-    printf("\nPlayer 2: %i points\n", p2->points_);
-    printf("Player 1: %i points\n\n", p1->points_);
+    renderString(renderer, "result ");
+    renderNumber(renderer, p1->points_);
+    renderText(renderer, " ", 1);
+    renderNumber(renderer, p2->points_);
+    renderText(renderer, "\n", 1);
+    return;
   }
+  if (renderer->mode_ != RENDER_TEXT)
+    return;
+
+  bool first_is_p1 = p1->points_ >= p2->points_;
+  Player* first = first_is_p1 ? p1 : p2;
+  Player* second = first_is_p1 ? p2 : p1;
+
+  renderString(renderer, first_is_p1 ? "\nPlayer 1: " : "\nPlayer 2: ");
+  renderNumber(renderer, first->points_);
+  renderString(renderer, first_is_p1 ? " points\nPlayer 2: " : " points\nPlayer 1: ");
+  renderNumber(renderer, second->points_);
+  renderString(renderer, " points\n\n");
 
   if (p1->points_ == p2->points_)
   {
     for (int i = 1; i < 3; i++)
     {
-      printf("Congratulations! Player %i wins the game!\n", i);
+      renderString(renderer, "Congratulations! Player ");
+      renderNumber(renderer, i);
+      renderString(renderer, " wins the game!\n");
     }
   }
   else if (p1->points_ > p2->points_)
-    printf("Congratulations! Player 1 wins the game!\n");
+    renderString(renderer, "Congratulations! Player 1 wins the game!\n");
   else
-    printf("Congratulations! Player 2 wins the game!\n");
-}
-
-//------------------------------------------------------------------------------
-///
-/// Free's latest card played (bluff card) and real hand from hand
-///
-/// @param latest_played_card bluff card
-/// @param latest_real_card real hand
-///
-/// @return no return
-//
-void freeLatest(char** latest_played_card, char** latest_real_card)
-{
-  if (*latest_played_card != NULL)
-  {
-    free(*latest_played_card);
-    *latest_played_card = NULL;
-  }
-  if (*latest_real_card != NULL)
-  {
-    free(*latest_real_card);
-    *latest_real_card = NULL;
-  }
+    renderString(renderer, "Congratulations! Player 2 wins the game!\n");
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Append results in file
+/// Append results in file. A binary deck is left as it is, its results go to
+/// a text file next to it with RESULTS_SUFFIX appended to the name
 ///
 /// @param file_name file used in the play
 /// @param p1 player 1
@@ -1581,7 +1932,22 @@ void freeLatest(char** latest_played_card, char** latest_real_card)
 //
 int appendResults(char* file_name, Player* p1, Player* p2)
 {
-  FILE* file = fopen(file_name, "a");
+  bool binary = deckFormat(file_name) == DECK_BINARY;
+  char* results_name = file_name;
+  if (binary)
+  {
+    size_t length = strlen(file_name);
+    results_name = (char*)malloc(length + sizeof(RESULTS_SUFFIX));
+    if (results_name != NULL)
+    {
+      memcpy(results_name, file_name, length);
+      memcpy(results_name + length, RESULTS_SUFFIX, sizeof(RESULTS_SUFFIX));
+    }
+  }
+
+  FILE* file = (results_name == NULL) ? NULL : fopen(results_name, "a");
+  if (binary)
+    free(results_name);
   if (file == NULL)
   {
     printf("Warning: Results not written to file!\n");
@@ -1619,52 +1985,186 @@ int appendResults(char* file_name, Player* p1, Player* p2)
 
 //------------------------------------------------------------------------------
 ///
-/// Free's Draw pile
+/// Writing a game that was left with quit to a save file. The quit itself is
+/// not saved, the player who quit is in turn again after --resume
 ///
-/// @param draw_pile draw pile
+/// @param file_name save file, overwritten
+/// @param game game
 ///
-/// @return no return
+/// @return 1 = file not written; 0 = saved
 //
-void freeCards(Card* draw_pile)
+int saveGame(char* file_name, EspGame* game)
 {
-  while (draw_pile != NULL)
-  {
-    Card* temp = draw_pile;
-    draw_pile = draw_pile->next_card_;
-    free(temp);
-  }
+  EspGame saved;
+  esp_game_clone(&saved, game);
+  if (saved.state_.result_ == QUIT)
+    saved.state_.result_ = 0;
+
+  uint8_t buffer[ESP_SAVE_SIZE];
+  esp_game_save(&saved, buffer);
+
+  FILE* file = fopen(file_name, "wb");
+  if (file == NULL)
+    return 1;
+
+  bool written = fwrite(buffer, 1, ESP_SAVE_SIZE, file) == ESP_SAVE_SIZE;
+  return (fclose(file) == 0 && written) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Reading a save file written by saveGame
+///
+/// @param file_name save file
+/// @param game game to continue
+/// @param deck deck of the config file the game was saved with
+///
+/// @return 1 = file not open; 2 = not a save of a running game on this deck; 0 = loaded
+//
+int loadGame(char* file_name, EspGame* game, DrawPile* deck)
+{
+  FILE* file = fopen(file_name, "rb");
+  if (file == NULL)
+    return 1;
+
+  uint8_t buffer[ESP_SAVE_SIZE + 1];
+  size_t length = fread(buffer, 1, sizeof(buffer), file);
+  fclose(file);
+
+  if (length != ESP_SAVE_SIZE || esp_game_load(game, deck, buffer) != 0 || esp_is_over(game) < 0)
+    return 2;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Initialising an arena with one block from the system allocator
+///
+/// @param arena arena to initialise
+/// @param size bytes of the block
+///
+/// @return 4 = Mem error; 0 = Valid
+//
+int initialiseArena(Arena* arena, size_t size)
+{
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  arena->base_ = (char*)aligned_alloc(ARENA_ALIGN, (size == 0) ? ARENA_ALIGN : size);
+  arena->size_ = size;
+  arena->used_ = 0;
+  return (arena->base_ == NULL) ? 4 : 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Taking the next bytes of the arena, aligned to ARENA_ALIGN
+///
+/// @param arena arena
+/// @param size bytes needed
+///
+/// @return memory; NULL = the arena is full
+//
+void* arenaAlloc(Arena* arena, size_t size)
+{
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  if (size > arena->size_ - arena->used_)
+    return NULL;
+
+  void* memory = arena->base_ + arena->used_;
+  arena->used_ += size;
+  return memory;
 }
 
 //------------------------------------------------------------------------------
 ///
-/// Free's all of the linked lists. Draw pile and player hands
+/// Freeing the block of an arena
 ///
-/// @param draw_pile draw pile
-/// @param p1_hand player 1 hand
-/// @param p2_hand player 2 hand
+/// @param arena arena
 ///
 /// @return no return
 //
-void freeAll(Card* draw_pile, Card* p1_hand, Card* p2_hand)
+void freeArena(Arena* arena)
 {
-  while (draw_pile != NULL)
-  {
-    Card* temp = draw_pile;
-    draw_pile = draw_pile->next_card_;
-    free(temp);
-  }
+  free(arena->base_);
+  arena->base_ = NULL;
+  arena->size_ = 0;
+  arena->used_ = 0;
+}
 
-  while (p1_hand != NULL)
-  {
-    Card* p1_temp = p1_hand;
-    p1_hand = p1_hand->next_card_;
-    free(p1_temp);
-  }
+#ifdef ESP_COUNT_ALLOCATIONS
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
 
-  while (p2_hand != NULL)
-  {
-    Card* p2_temp = p2_hand;
-    p2_hand = p2_hand->next_card_;
-    free(p2_temp);
-  }
+static _Atomic size_t allocation_count = 0;
+static _Atomic size_t free_count = 0;
+
+//------------------------------------------------------------------------------
+///
+/// Counting replacements for the glibc allocator, only compiled in with
+/// -DESP_COUNT_ALLOCATIONS so the simulation can check that turns do not allocate.
+/// The runner allocates from several threads, so the counters are atomic.
+/// aligned_alloc is counted too, the blocks of arenas are freed with free
+//
+void* malloc(size_t size)
+{
+  allocation_count++;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+  allocation_count++;
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size)
+{
+  allocation_count++;
+  return __libc_realloc(pointer, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+  allocation_count++;
+  return __libc_memalign(alignment, size);
+}
+
+void free(void* pointer)
+{
+  if (pointer != NULL)
+    free_count++;
+  __libc_free(pointer);
+}
+#endif
+
+//------------------------------------------------------------------------------
+///
+/// Number of malloc/calloc/realloc/aligned_alloc calls so far
+///
+/// @return allocations; 0 = not built with -DESP_COUNT_ALLOCATIONS
+//
+size_t allocationCount(void)
+{
+#ifdef ESP_COUNT_ALLOCATIONS
+  return allocation_count;
+#else
+  return 0;
+#endif
+}
+
+//------------------------------------------------------------------------------
+///
+/// Number of free calls so far
+///
+/// @return frees; 0 = not built with -DESP_COUNT_ALLOCATIONS
+//
+size_t freeCount(void)
+{
+#ifdef ESP_COUNT_ALLOCATIONS
+  return free_count;
+#else
+  return 0;
+#endif
 }
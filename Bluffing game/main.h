@@ -5,123 +5,307 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
-
-#define BUFFERSIZE 5
+#include <stdint.h>
+
+#include "esp.h"
+#include "deck.h"
+
+#define BOT_MOVE_SIZE 32
+#define READ_CHUNK 65536
+#define LINE_LENGTH_MAX 1024
+#define RENDER_BUFFER_SIZE 8192
+#define ARENA_ALIGN 64
+#define RESULTS_SUFFIX ".results"
+#define RANDOM_DECK_PREFIX "random:"
+#define DEFAULT_COMPOSITION "*_*=3"
+#define SCORE_BUCKETS 64
+#define SCORE_BUCKET_WIDTH 4
+
+#define USAGE "Usage: ./main [--simulate <games> [--seed <seed>]] [--record <moves file>]\n" \
+  "              [--output <text|events|off>] [--save <save file>] [--resume <save file>]\n" \
+  "              [--shuffle <seed>] [--stats] [--p1 <seat>] [--p2 <seat>] <config file>\n" \
+  "       ./main [--simulate <games>] [--seed <seed>] [--record <moves file>] [--output <mode>]\n" \
+  "              --stream <config file|random:<cards>>\n" \
+  "       ./main --simulate <games> --threads <threads> [--seed <seed>] [--shuffle <seed>]\n" \
+  "              <config file>\n" \
+  "       ./main --generate-decks <decks> [--seed <seed>] [--composition <spec>]\n" \
+  "              [--format <text|binary>] <name prefix>\n" \
+  "       ./main --bench-parse <moves file>\n" \
+  "       ./main --bench-load <config file> [threads]\n" \
+  "       ./main --verify-undo <games> <config file>\n" \
+  "       ./main --bench-search <depth> <config file>\n" \
+  "       ./main --bench <config file> [baseline file]\n" \
+  "       ./main --bench-replay <moves file> <config file> [baseline file [max regression %]]\n" \
+  "       ./main --train-cfr <iterations> <config file> <table file> [threads]\n" \
+  "       ./main --solve <max depth> <threads> <config file> [save file]\n" \
+  "       seats: human, random, mcts:<ms>ms[:<threads>] or cfr:<table file>\n"
+
+// who makes the moves of a seat, see --p1 and --p2
+enum {
+  SEAT_DEFAULT,  // human in a game, random bot in a simulation
+  SEAT_HUMAN,
+  SEAT_RANDOM,
+  SEAT_MCTS,
+  SEAT_CFR
+};
 
 enum {
-  GAME_END,
-  WRONG_USAGE,
-  CANT_OPEN_FILE,
-  INVALID_FILE,
-  ALLOC_FAIL,
-  DRAW_PILE_EMPTY,
-  QUIT = -1
+  RENDER_TEXT,
+  RENDER_EVENTS,
+  RENDER_OFF
 };
 
-typedef struct _Card_
+typedef struct _TurnView_
+{
+  Player* self_;
+  Player* opponent_;
+  int curr_player_;
+  int cards_played_;
+  int last_action_;
+  char curr_spice_;
+  Card latest_played_card_;
+  EspGame* game_;  // for bots that search, they must only look at what their player can see
+} TurnView;
+
+// the provider owns the line, it stays valid until the provider is called again
+typedef int (*MoveProvider)(void* context, TurnView* view, char** line);
+
+typedef struct _Seat_
+{
+  MoveProvider provide_;
+  void* context_;
+} Seat;
+
+typedef struct _Renderer_
+{
+  int mode_;      // RENDER_*
+  FILE* out_;
+  char* buffer_;  // RENDER_BUFFER_SIZE bytes, NULL when the output is off
+  size_t length_; // bytes waiting for the next flush
+} Renderer;
+
+// endless or bounded deck of random cards, see readRandomCards
+typedef struct _RandomDeck_
+{
+  uint64_t seed_;
+  uint64_t state_;
+  uint64_t size_;      // cards of the deck; 0 = endless
+  uint64_t remaining_; // cards left when the deck is bounded
+} RandomDeck;
+
+// a deck streamed through the ring of a PileStream instead of being loaded
+typedef struct _StreamDeck_
+{
+  PileStream pile_;
+  TextSource text_;
+  RandomDeck random_;
+  bool generated_;     // random deck, no file
+  char* name_;
+} StreamDeck;
+
+// counters of a run of games, one per worker, added up at the end
+typedef struct _GameStats_
+{
+  unsigned long games_;
+  unsigned long wins_[3];                   // draws, player 1, player 2
+  long points_[2];                          // sum of the final points of each seat
+  unsigned long scores_[2][SCORE_BUCKETS];  // games by final points / SCORE_BUCKET_WIDTH
+  unsigned long turns_;                     // turns of all games
+  unsigned long shortest_;                  // turns of the shortest game
+  unsigned long longest_;
+  unsigned long challenges_[3];             // by CHALLENGE_*
+  unsigned long successes_[3];
+} GameStats;
+
+typedef struct _Session_
+{
+  Seat seats_[2];
+  Renderer* renderer_;
+  unsigned long turns_;
+  FILE* record_; // every provided move line is appended here, NULL = off
+  StreamDeck* stream_; // refilled before every turn, NULL = deck in memory
+  GameStats* stats_;   // challenges are counted here, NULL = off
+} Session;
+
+// one block handed out front to back and given back as a whole
+typedef struct _Arena_
+{
+  char* base_;
+  size_t size_;
+  size_t used_;
+} Arena;
+
+typedef struct _RandomBot_
 {
-  int value_;
-  char spice_;
-  struct _Card_* next_card_;
-} Card;
+  uint64_t state_;
+  char move_[BOT_MOVE_SIZE];
+} RandomBot;
+
+struct _MctsBot_;
+struct _CfrBot_;
 
-typedef struct _Player_
+// bots taking the seats of --p1 and --p2, NULL = no such bot on the seat
+typedef struct _SeatBots_
 {
-  Card* hand_;
-  int points_;
-} Player;
+  RandomBot random_[2];
+  struct _MctsBot_* mcts_[2];
+  struct _CfrBot_* cfr_[2];
+} SeatBots;
 
-void initialisePlayers(Player* p1, Player* p2);
+typedef struct _LineReader_
+{
+  int fd_;
+  char* buffer_;   // READ_CHUNK bytes plus a terminator
+  size_t start_;   // first byte not handed out yet
+  size_t end_;     // one past the last byte read from the fd
+  bool discard_;   // rest of an overlong line still has to be skipped
+  bool eof_;
+} LineReader;
+
+typedef struct _HumanSeat_
+{
+  LineReader* input_;
+  Renderer* renderer_; // the prompt is flushed through it before reading
+} HumanSeat;
 
-int extractCardsFromFile(char* file_name, Card** draw_pile);
+typedef struct _SeatOption_
+{
+  int kind_;        // SEAT_*
+  int budget_ms_;   // mcts: search time per move
+  int threads_;     // mcts: search threads
+  char* table_name_; // cfr: strategy table written by --train-cfr
+} SeatOption;
 
-void distributeCardsToPlayers(Card** draw_pile, Player* p1, Player* p2);
+typedef struct _Options_
+{
+  bool simulate_;
+  unsigned long games_;
+  uint64_t seed_;
+  char* record_name_; // NULL = no recording
+  int render_mode_;   // RENDER_*
+  char* save_name_;   // NULL = quit discards the game
+  char* resume_name_; // NULL = new game
+  char* config_name_;
+  bool stream_;       // config_name_ is streamed, see openStreamDeck
+  bool shuffle_;      // every game plays the deck shuffled by (shuffle_seed_, game index)
+  uint64_t shuffle_seed_;
+  bool generate_;       // --generate-decks: config_name_ is the name prefix of the decks
+  unsigned long decks_;
+  char* composition_;   // cards of generated decks, see parseComposition
+  int deck_format_;     // DECK_TEXT or DECK_BINARY
+  int threads_;         // --simulate on a pool of threads; 0 = the single-threaded simulation
+  bool stats_;          // print the phase statistics at the end and on SIGUSR1
+  SeatOption seats_[2]; // --p1 and --p2
+} Options;
 
-void sortPlayerHand(Player* p);
+int parseOptions(int argc, char* argv[], Options* options);
 
-int gameplay(Card** draw_pile, Player* p1, Player* p2);
+int parseSeat(char* value, SeatOption* seat);
 
-int turnsInGameplay(Card** draw_pile, Player* p1, Player* p2, int* curr_turn, char* curr_spice,
-  char** latest_played_card, char** latest_real_card, int* cards_played_in_round,
-  int* last_action, int* last_round_loser);
+int playGame(Options* options);
 
-void printPlayerInfo(Player* p1, Player* p2, int* curr_player, int curr_turn,
-  char* latest_played_card, int cards_played_in_round);
+int simulateGames(Options* options);
 
-void printPlayerHand(Player* p);
+int generateDecks(Options* options);
 
-int inputMove(Player* p, Player* p1, Player* p2, Card** draw_pile, int curr_player, char* curr_spice,
-  char** latest_played_card, char** latest_real_card, int* cards_played_in_round, int* last_action, int* loser);
+int shuffleDeck(DrawPile* deck, uint64_t seed, uint64_t game);
 
-int userInput(char** move, size_t length, size_t* curr_char);
+int loadDeck(char* file_name, DrawPile* deck);
 
-bool isCommand(char* move, char* check);
+int openStreamDeck(StreamDeck* stream, char* name, uint64_t seed);
 
-bool isQuit(char* move, char** latest_played_card, char** latest_real_card);
+void closeStreamDeck(StreamDeck* stream);
 
-int movePlay(char* move, char** latest_played_card, char** latest_real_card,
-  int* cards_played_in_round, int* last_action, char* curr_spice, int curr_player, Player* p1, Player* p2);
+int startStreamGame(StreamDeck* stream, EspGame* game);
 
-void moveSwap(char* move, char** latest_real_card, int* last_action,
-  int curr_player, int* loser, Player* p1, Player* p2, int* cards_played);
+int refillStreamDeck(StreamDeck* stream, EspGame* game);
 
-void deleteFromHand(Player* p1, Player* p2, int curr_player, char** latest_real_card);
+void freeDeck(DrawPile* deck, StreamDeck* stream);
 
-void moveChallenge(char* move, char** latest_played_card, char** latest_real_card, int* last_action,
-  int curr_player, int* loser, Player* p1, Player* p2, int* cards_played);
+int readRandomCards(void* context, Card* cards, size_t capacity, size_t* count);
 
-void compareSpices(char** latest_played_card, char** latest_real_card, int curr_player, int* loser,
-  Player* p1, Player* p2, int* cards_played);
+int rewindRandomCards(void* context);
 
-void compareValues(char** latest_played_card, char** latest_real_card, int curr_player, int* loser,
-  Player* p1, Player* p2, int* cards_played);
+void initialiseSession(Session* session, HumanSeat* human, Renderer* renderer);
 
-void printChallenge(char** latest_played_card, char** latest_real_card, int curr_player,
-  Player* p1, Player* p2, bool challenge_successful, int value_or_spice, int* cards_played);
+int seatPlayers(Session* session, Options* options, SeatBots* bots);
 
-int drawTwoCards(Card** draw_pile, Player* p);
+void unseatPlayers(SeatBots* bots);
 
-int drawSixCards(Card** draw_pile, Player* p);
+void reportSeats(SeatBots* bots, FILE* out);
 
-bool allocateCards(char** latest_played_card, char** latest_real_card,
-  char* played_card, char* real_card);
+int initialiseRenderer(Renderer* renderer, int mode, FILE* out);
 
-bool isValidMove(char* move, int* cards_played, int* last_action, Player* p1, Player* p2,
-  int curr_player, char** latest_played_card, char* curr_spice);
+void freeRenderer(Renderer* renderer);
 
-int parameterCounter(char* move);
+void renderFlush(Renderer* renderer);
 
-bool isParameterValid(char* move, int parameter_count);
+void renderText(Renderer* renderer, const char* text, size_t length);
 
-bool isCommandValid(char* move);
+void renderString(Renderer* renderer, const char* text);
 
-bool isCommandTimedRight(char* move, int* cards_played, int* last_action,
-  Player* p1, Player* p2, int curr_player);
+void renderNumber(Renderer* renderer, int number);
 
-bool isFormatValid(char* move);
+void renderCard(Renderer* renderer, Card card);
 
-bool isInHand(char* move, Player* p);
+void renderWelcome(Renderer* renderer);
 
-bool isValidCurrentPlay(char* move, int* cards_played, char** latest_played_card, char* curr_spice);
+void renderRoundStart(Renderer* renderer);
 
-bool isValidChallengeType(char* move);
+void renderTurn(Renderer* renderer, int curr_player, Player* p, Player* opponent,
+  Card latest_played_card, int cards_played_in_round);
 
-int Draw(char* move, Player* p, Card** draw_pile, int* last_action);
+void renderPrompt(Renderer* renderer, int curr_player);
 
-int addDrawedCard(Player* p, Card** draw_pile);
+void renderMove(Renderer* renderer, int curr_player, Move* move);
 
-void printResults(Player* p1, Player* p2);
+void renderError(Renderer* renderer, int error);
 
-void freeLatest(char** latest_played_card, char** latest_real_card);
+void renderChallenge(Renderer* renderer, Card latest_played_card, Card latest_real_card,
+  int challenge, bool challenge_successful);
+
+void renderPoints(Renderer* renderer, int player, int points, bool bonus);
+
+void renderResults(Renderer* renderer, Player* p1, Player* p2);
+
+int initialiseLineReader(LineReader* reader, int fd);
+
+void freeLineReader(LineReader* reader);
+
+int readLine(LineReader* reader, char** line);
+
+int gameplay(Session* session, EspGame* game);
+
+int turnsInGameplay(Session* session, EspGame* game);
+
+int inputMove(Session* session, EspGame* game);
+
+int humanMove(void* context, TurnView* view, char** line);
+
+int randomMove(void* context, TurnView* view, char** line);
+
+uint64_t nextRandom(uint64_t* state);
+
+void parseMove(char* line, Move* move);
+
+Card parseCard(char* word, size_t length);
+
+void formatMove(Move* move, char* line);
 
 int appendResults(char* file_name, Player* p1, Player* p2);
 
-void freeCards(Card* draw_pile);
+int saveGame(char* file_name, EspGame* game);
+
+int loadGame(char* file_name, EspGame* game, DrawPile* deck);
+
+int initialiseArena(Arena* arena, size_t size);
+
+void* arenaAlloc(Arena* arena, size_t size);
 
-void freeAll(Card* draw_pile, Card* p1_hand, Card* p2_hand);
+void freeArena(Arena* arena);
 
-void deleteWhenIndex(Player* curr_p, int index, int* value, char* spice);
+size_t allocationCount(void);
 
-bool isValidSwap(char* move, int curr_player, Player* p1, Player* p2);
+size_t freeCount(void);
 
 #endif // MAIN_H
\ No newline at end of file
@@ -0,0 +1,665 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "mcts.h"
+
+static bool pastDeadline(struct timespec* deadline);
+static uint64_t randomBelow(uint64_t* random, uint64_t bound);
+
+//------------------------------------------------------------------------------
+///
+/// Parsing the budget of an mcts seat like 50ms or 50ms:4, the number after
+/// the second colon is the number of search threads
+///
+/// @param spec seat option after "mcts:"
+/// @param budget_ms milliseconds of search per move
+/// @param threads search threads, 1 when not given
+///
+/// @return 1 = wrong usage; 0 = Valid
+//
+int parseMctsSeat(char* spec, int* budget_ms, int* threads)
+{
+  char* end = NULL;
+  long budget = strtol(spec, &end, 10);
+  if (end == spec || strncmp(end, "ms", 2) != 0 || budget <= 0 || budget > 3600000)
+    return WRONG_USAGE;
+
+  end += 2;
+  long count = 1;
+  if (*end == ':')
+  {
+    char* number = end + 1;
+    count = strtol(number, &end, 10);
+    if (end == number || count <= 0 || count > MCTS_THREADS_MAX)
+      return WRONG_USAGE;
+  }
+  if (*end != '\0')
+    return WRONG_USAGE;
+
+  *budget_ms = (int)budget;
+  *threads = (int)count;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Initialising a bot and starting the threads of its pool. Trees and buffers
+/// of all workers come from one arena, so a search allocates nothing
+///
+/// @param bot bot to initialise
+/// @param budget_ms milliseconds of search per move
+/// @param threads search threads including the one asking for the move
+/// @param seed seed of the random numbers of the workers
+///
+/// @return 4 = Mem error; 0 = Valid
+//
+int initialiseMctsBot(MctsBot* bot, int budget_ms, int threads, uint64_t seed)
+{
+  memset(bot, 0, sizeof(MctsBot));
+  bot->budget_ms_ = budget_ms;
+  bot->threads_ = threads;
+  bot->known_played_ = -1;
+
+  size_t worker_bytes = sizeof(MctsNode) * MCTS_NODES_MAX + MCTS_UNSEEN_MAX + MCTS_POOL_CARDS +
+    sizeof(Move) * ESP_MOVES_MAX + sizeof(MctsChoices) + 5 * ARENA_ALIGN;
+  if (initialiseArena(&bot->arena_, (size_t)threads * (worker_bytes + sizeof(MctsWorker) + sizeof(pthread_t)) +
+      2 * ARENA_ALIGN) != 0)
+    return ALLOC_FAIL;
+
+  bot->workers_ = (MctsWorker*)arenaAlloc(&bot->arena_, (size_t)threads * sizeof(MctsWorker));
+  bot->pool_ = (pthread_t*)arenaAlloc(&bot->arena_, (size_t)threads * sizeof(pthread_t));
+  for (int index = 0; index < threads; index++)
+  {
+    MctsWorker* worker = &bot->workers_[index];
+    worker->bot_ = bot;
+    worker->nodes_ = (MctsNode*)arenaAlloc(&bot->arena_, sizeof(MctsNode) * MCTS_NODES_MAX);
+    worker->unseen_ = (Card*)arenaAlloc(&bot->arena_, MCTS_UNSEEN_MAX);
+    worker->ring_ = (Card*)arenaAlloc(&bot->arena_, MCTS_POOL_CARDS);
+    worker->moves_ = (Move*)arenaAlloc(&bot->arena_, sizeof(Move) * ESP_MOVES_MAX);
+    worker->choices_ = (MctsChoices*)arenaAlloc(&bot->arena_, sizeof(MctsChoices));
+    worker->choices_->count_ = 0;
+    memset(worker->choices_->slots_, 0xFF, sizeof(worker->choices_->slots_));
+    worker->random_ = counterRandom(seed, 0, (uint64_t)index);
+  }
+
+  pthread_mutex_init(&bot->lock_, NULL);
+  pthread_cond_init(&bot->start_, NULL);
+  pthread_cond_init(&bot->done_, NULL);
+
+  // a thread that cannot be started leaves the search to the ones before it
+  for (int index = 1; index < threads; index++)
+  {
+    if (pthread_create(&bot->pool_[index], NULL, mctsThread, &bot->workers_[index]) != 0)
+    {
+      bot->threads_ = index;
+      break;
+    }
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Stopping the pool of a bot and freeing its arena
+///
+/// @param bot bot
+///
+/// @return no return
+//
+void freeMctsBot(MctsBot* bot)
+{
+  pthread_mutex_lock(&bot->lock_);
+  bot->stop_ = true;
+  pthread_cond_broadcast(&bot->start_);
+  pthread_mutex_unlock(&bot->lock_);
+  for (int index = 1; index < bot->threads_; index++)
+    pthread_join(bot->pool_[index], NULL);
+
+  pthread_cond_destroy(&bot->done_);
+  pthread_cond_destroy(&bot->start_);
+  pthread_mutex_destroy(&bot->lock_);
+  freeArena(&bot->arena_);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Printing the moves and playouts of a bot
+///
+/// @param bot bot
+/// @param player seat of the bot, 1 or 2
+/// @param out stream to print to
+///
+/// @return no return
+//
+void reportMctsBot(MctsBot* bot, int player, FILE* out)
+{
+  fprintf(out, "Player %d (mcts %d ms, %d threads): %lu moves, %lu playouts, %.0f playouts/sec\n", player,
+    bot->budget_ms_, bot->threads_, bot->moves_, bot->playouts_,
+    (bot->seconds_ > 0) ? (double)bot->playouts_ / bot->seconds_ : 0.0);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Move provider of the ISMCTS bot. Every worker searches its own tree over
+/// determinizations of the hidden cards until the budget is used up, the move
+/// played most often at the roots of all trees is made
+///
+/// @param context MctsBot
+/// @param view state of the turn, the bot reads the game only for what its
+///        player can see
+/// @param line move line, written to the bots move buffer
+///
+/// @return 0 = Valid
+//
+int mctsMove(void* context, TurnView* view, char** line)
+{
+  MctsBot* bot = (MctsBot*)context;
+  MctsWorker* main_worker = &bot->workers_[0];
+  MctsChoices* choices = main_worker->choices_;
+  int player = view->curr_player_;
+  *line = bot->move_;
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  prepareSearch(bot, view->game_);
+
+  int count = esp_legal_moves(&bot->root_, main_worker->moves_, ESP_MOVES_MAX);
+  listChoices(&bot->root_, main_worker->moves_, count, player, choices, &main_worker->random_);
+  if (choices->count_ > 1)
+  {
+    long nanoseconds = start.tv_nsec + (long)(bot->budget_ms_ % 1000) * 1000000;
+    bot->deadline_.tv_sec = start.tv_sec + bot->budget_ms_ / 1000 + nanoseconds / 1000000000;
+    bot->deadline_.tv_nsec = nanoseconds % 1000000000;
+
+    pthread_mutex_lock(&bot->lock_);
+    bot->generation_++;
+    bot->pending_ = bot->threads_ - 1;
+    pthread_cond_broadcast(&bot->start_);
+    pthread_mutex_unlock(&bot->lock_);
+
+    searchMcts(main_worker);
+
+    pthread_mutex_lock(&bot->lock_);
+    while (bot->pending_ > 0)
+      pthread_cond_wait(&bot->done_, &bot->lock_);
+    pthread_mutex_unlock(&bot->lock_);
+
+    // root parallel: the visits of the root children of all trees are added up
+    uint32_t visits[ESP_MOVE_INDICES] = { 0 };
+    for (int index = 0; index < bot->threads_; index++)
+    {
+      MctsWorker* worker = &bot->workers_[index];
+      bot->playouts_ += worker->playouts_;
+      for (uint32_t child = worker->nodes_[0].child_; child != 0; child = worker->nodes_[child].sibling_)
+        visits[worker->nodes_[child].key_] += worker->nodes_[child].visits_;
+    }
+
+    // the search reused the choices, the root moves are listed again
+    count = esp_legal_moves(&bot->root_, main_worker->moves_, ESP_MOVES_MAX);
+    listChoices(&bot->root_, main_worker->moves_, count, player, choices, &main_worker->random_);
+    int best = 0;
+    for (int slot = 1; slot < choices->count_; slot++)
+    {
+      if (visits[choices->keys_[slot]] > visits[choices->keys_[best]])
+        best = slot;
+    }
+    choices->moves_[0] = choices->moves_[best];
+  }
+
+  Move move = { MOVE_QUIT, 1, NO_CARD, NO_CARD, CHALLENGE_NONE, 0 };
+  if (choices->count_ > 0)
+  {
+    move = choices->moves_[0];
+    concreteMove(&bot->root_, &move, &main_worker->random_);
+  }
+  formatMove(&move, bot->move_);
+
+  if (move.kind_ == MOVE_PLAY)
+  {
+    GameState* state = &bot->root_.state_;
+    bot->known_played_ = state->cards_played_ + 1;
+    bot->known_claim_ = move.played_card_;
+    bot->known_points_ = state->players_[0].points_ + state->players_[1].points_;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  bot->seconds_ += (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+  bot->moves_++;
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Setting up the search of a move: the game as the bot sees it and the cards
+/// it has not seen. Unseen are the opponents hand, the real card under the
+/// opponents latest play and the draw pile, or MCTS_POOL_CARDS cards drawn
+/// from what is left of a longer one. The bot knows which cards are still in
+/// play, not where they are
+///
+/// @param bot bot
+/// @param game game of the turn
+///
+/// @return no return
+//
+void prepareSearch(MctsBot* bot, EspGame* game)
+{
+  bot->root_ = *game;
+  GameState* state = &bot->root_.state_;
+  Hand* opponent = &state->players_[2 - state->curr_player_].hand_;
+  uint32_t count = 0;
+
+  for (uint32_t present = handPresent(opponent); present != 0; present &= present - 1)
+  {
+    Card card = (Card)__builtin_ctz(present);
+    for (int copy = handCount(opponent, card); copy > 0; copy--)
+      bot->unseen_[count++] = card;
+  }
+  bot->opponent_size_ = (int)count;
+
+  // the real card of the bots own play is known until the round ends
+  bool own_play = state->cards_played_ == bot->known_played_ && state->latest_played_card_ == bot->known_claim_ &&
+    state->players_[0].points_ + state->players_[1].points_ == bot->known_points_;
+  bot->hidden_real_ = state->cards_played_ > 0 && !own_play;
+  if (bot->hidden_real_)
+    bot->unseen_[count++] = state->latest_real_card_;
+
+  uint32_t pile = game->deck_size_ - state->pile_next_;
+  bot->pile_cards_ = (pile < MCTS_POOL_CARDS) ? pile : MCTS_POOL_CARDS;
+  if (pile <= MCTS_POOL_CARDS)
+  {
+    for (uint32_t card = 0; card < pile; card++)
+      bot->unseen_[count++] = game->deck_[(state->pile_next_ + card) & game->deck_mask_];
+    bot->unseen_count_ = count;
+    return;
+  }
+
+  // a longer pile gives a sample of what is left of it, not its next cards,
+  // the bot knows the composition but not the order
+  uint32_t kinds[CARD_KINDS] = { 0 };
+  for (uint32_t card = 0; card < pile; card++)
+    kinds[game->deck_[(state->pile_next_ + card) & game->deck_mask_]]++;
+  uint64_t* random = &bot->workers_[0].random_;
+  for (uint32_t card = 0; card < MCTS_POOL_CARDS; card++, pile--)
+  {
+    uint64_t pick = randomBelow(random, pile);
+    Card kind = 0;
+    while (pick >= kinds[kind])
+      pick -= kinds[kind++];
+    kinds[kind]--;
+    bot->unseen_[count++] = kind;
+  }
+  bot->unseen_count_ = count;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Thread of a pool worker, runs one search for every new generation until
+/// the bot is freed
+///
+/// @param argument MctsWorker
+///
+/// @return NULL
+//
+void *mctsThread(void* argument)
+{
+  MctsWorker* worker = (MctsWorker*)argument;
+  MctsBot* bot = worker->bot_;
+  unsigned long generation = 0;
+
+  pthread_mutex_lock(&bot->lock_);
+  while (true)
+  {
+    while (bot->generation_ == generation && !bot->stop_)
+      pthread_cond_wait(&bot->start_, &bot->lock_);
+    if (bot->stop_)
+      break;
+    generation = bot->generation_;
+    pthread_mutex_unlock(&bot->lock_);
+
+    searchMcts(worker);
+
+    pthread_mutex_lock(&bot->lock_);
+    if (--bot->pending_ == 0)
+      pthread_cond_signal(&bot->done_);
+  }
+  pthread_mutex_unlock(&bot->lock_);
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Single-observer ISMCTS on the tree of one worker until the deadline. Every
+/// iteration deals the unseen cards anew and only follows moves legal in that
+/// deal, a child is chosen by UCB over the iterations it was available in.
+/// The opponents plays are told apart by the claimed card only and swaps by
+/// the given card only, since that is all the bot sees of them
+///
+/// @param worker worker with its tree, the search is in worker->bot_
+///
+/// @return no return
+//
+void searchMcts(MctsWorker* worker)
+{
+  MctsBot* bot = worker->bot_;
+  MctsChoices* choices = worker->choices_;
+  int bot_player = bot->root_.state_.curr_player_;
+  MctsNode* nodes = worker->nodes_;
+  memcpy(worker->unseen_, bot->unseen_, bot->unseen_count_);
+  memset(&nodes[0], 0, sizeof(MctsNode));
+  worker->node_count_ = 1;
+  worker->playouts_ = 0;
+
+  do
+  {
+    EspGame game;
+    determinize(worker, &game);
+    uint32_t path[MCTS_PATH_MAX];
+    int depth = 0;
+    uint32_t node = 0;
+
+    while (esp_is_over(&game) == 0 && depth < MCTS_PATH_MAX)
+    {
+      int count = esp_legal_moves(&game, worker->moves_, ESP_MOVES_MAX);
+      listChoices(&game, worker->moves_, count, bot_player, choices, &worker->random_);
+      if (choices->count_ == 0)
+        break;
+
+      // children legal in this deal become available, seen_ = 0 marks the tried keys
+      uint32_t best = 0;
+      double best_value = -1.0;
+      int untried = choices->count_;
+      for (uint32_t child = nodes[node].child_; child != 0; child = nodes[child].sibling_)
+      {
+        int slot = choices->slots_[nodes[child].key_];
+        if (slot < 0)
+          continue;
+        choices->seen_[slot] = 0;
+        untried--;
+        MctsNode* candidate = &nodes[child];
+        candidate->available_++;
+        double value = (double)candidate->reward_ / candidate->visits_ +
+          MCTS_EXPLORATION * sqrt(log((double)candidate->available_) / candidate->visits_);
+        if (value > best_value)
+        {
+          best_value = value;
+          best = child;
+        }
+      }
+
+      int slot = -1;
+      if (untried > 0 && worker->node_count_ < MCTS_NODES_MAX)
+      {
+        int pick = (int)randomBelow(&worker->random_, (uint64_t)untried);
+        for (slot = 0; choices->seen_[slot] == 0 || pick-- > 0; slot++)
+          ;
+        MctsNode* child = &nodes[worker->node_count_];
+        memset(child, 0, sizeof(MctsNode));
+        child->key_ = choices->keys_[slot];
+        child->player_ = game.state_.curr_player_;
+        child->available_ = 1;
+        child->sibling_ = nodes[node].child_;
+        nodes[node].child_ = worker->node_count_;
+        best = worker->node_count_++;
+      }
+      else if (best != 0)
+        slot = choices->slots_[nodes[best].key_];
+      else
+        break;
+
+      Move move = choices->moves_[slot];
+      concreteMove(&game, &move, &worker->random_);
+      esp_apply(&game, &move, NULL);
+      path[depth++] = best;
+      node = best;
+      if (nodes[node].visits_ == 0)
+        break; // expanded, the rest is played out
+    }
+
+    double reward = rollout(worker, &game);
+    nodes[0].visits_++;
+    for (int step = 0; step < depth; step++)
+    {
+      MctsNode* visited = &nodes[path[step]];
+      visited->visits_++;
+      visited->reward_ += (float)((visited->player_ == 1) ? reward : 1.0 - reward);
+    }
+    worker->playouts_++;
+  } while (!pastDeadline(&bot->deadline_));
+}
+
+//------------------------------------------------------------------------------
+///
+/// Dealing the unseen cards of the search at random: the opponents hand, the
+/// hidden real card and the draw pile in the ring of the worker
+///
+/// @param worker worker with the unseen cards and the ring
+/// @param game game to write
+///
+/// @return no return
+//
+void determinize(MctsWorker* worker, EspGame* game)
+{
+  MctsBot* bot = worker->bot_;
+  Card* unseen = worker->unseen_;
+  uint32_t count = bot->unseen_count_;
+  for (uint32_t card = count; card > 1; card--)
+  {
+    uint32_t other = (uint32_t)randomBelow(&worker->random_, card);
+    Card swapped = unseen[card - 1];
+    unseen[card - 1] = unseen[other];
+    unseen[other] = swapped;
+  }
+
+  *game = bot->root_;
+  GameState* state = &game->state_;
+  Hand* opponent = &state->players_[2 - state->curr_player_].hand_;
+  memset(opponent, 0, sizeof(Hand));
+
+  // cards past HAND_COPIES_MAX copies go to the front and onto the draw pile
+  uint32_t skipped = 0;
+  uint32_t next = 0;
+  for (int dealt = 0; next < count && dealt < bot->opponent_size_; next++)
+  {
+    if (handAdd(opponent, unseen[next]))
+      dealt++;
+    else
+    {
+      Card swapped = unseen[skipped];
+      unseen[skipped++] = unseen[next];
+      unseen[next] = swapped;
+    }
+  }
+
+  uint32_t rest = 0;
+  Card* ring = worker->ring_;
+  for (uint32_t card = 0; card < skipped + count - next; card++)
+  {
+    Card dealt = (card < skipped) ? unseen[card] : unseen[next + card - skipped];
+    if (bot->hidden_real_ && card == 0)
+      state->latest_real_card_ = dealt;
+    else if (rest < MCTS_POOL_CARDS)
+      ring[(state->pile_next_ + rest++) & (MCTS_POOL_CARDS - 1)] = dealt;
+  }
+  game->deck_ = ring;
+  game->deck_mask_ = MCTS_POOL_CARDS - 1;
+  game->deck_size_ = state->pile_next_ + rest;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Collecting the keys of the legal moves with one move for each key, picked
+/// at random among the moves that fall under it
+///
+/// @param game game the moves are legal in
+/// @param moves legal moves, quit is left out
+/// @param count number of moves
+/// @param bot_player player of the bot, the moves of the other one are keyed
+///        by what the bot sees of them
+/// @param choices choices to fill
+/// @param random random number state
+///
+/// @return no return
+//
+void listChoices(EspGame* game, Move* moves, int count, int bot_player, MctsChoices* choices, uint64_t* random)
+{
+  for (int slot = 0; slot < choices->count_; slot++)
+    choices->slots_[choices->keys_[slot]] = -1;
+  choices->count_ = 0;
+
+  bool observed_only = game->state_.curr_player_ != bot_player;
+  for (int index = 0; index < count; index++)
+  {
+    if (moves[index].kind_ == MOVE_QUIT)
+      continue;
+    int key = moveKey(&moves[index], observed_only);
+    int slot = choices->slots_[key];
+    if (slot < 0)
+    {
+      slot = choices->count_++;
+      choices->slots_[key] = (int16_t)slot;
+      choices->keys_[slot] = (uint16_t)key;
+      choices->moves_[slot] = moves[index];
+      choices->seen_[slot] = 1;
+    }
+    else if (randomBelow(random, ++choices->seen_[slot]) == 0)
+      choices->moves_[slot] = moves[index];
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Key of a move in the search tree, its move index with the hidden parts left
+/// out. A swap is keyed by the given card, the taken one is drawn blind
+///
+/// @param move legal move
+/// @param observed_only the move is the opponents, its real card is not seen
+///
+/// @return key, 0 to ESP_MOVE_INDICES - 1
+//
+int moveKey(Move* move, bool observed_only)
+{
+  switch (move->kind_)
+  {
+    case MOVE_DRAW:
+      return ESP_INDEX_DRAW;
+    case MOVE_CHALLENGE:
+      return ESP_INDEX_CHALLENGE + move->challenge_ - 1;
+    case MOVE_PLAY:
+      return ESP_INDEX_PLAY + (observed_only ? 0 : move->real_card_ * CARD_KINDS) + move->played_card_;
+    case MOVE_SWAP:
+      return ESP_INDEX_SWAP + move->real_card_ * CARD_KINDS;
+    default:
+      return ESP_INDEX_QUIT;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Filling in what the key of a move left open: a swap takes a card at a
+/// random index of the opponents hand
+///
+/// @param game game the move is made in
+/// @param move move to complete
+/// @param random random number state
+///
+/// @return no return
+//
+void concreteMove(EspGame* game, Move* move, uint64_t* random)
+{
+  if (move->kind_ != MOVE_SWAP)
+    return;
+  Hand* opponent = &game->state_.players_[2 - game->state_.curr_player_].hand_;
+  move->swap_index_ = (int)randomBelow(random, (uint64_t)handSize(opponent));
+}
+
+//------------------------------------------------------------------------------
+///
+/// Playing a game to its end with a cheap policy: challenges now and then,
+/// mostly plays, preferring honest ones, sometimes a draw or a swap. Stops
+/// after MCTS_ROLLOUT_MOVES moves
+///
+/// @param worker worker with the move buffer and random numbers
+/// @param game game to play out
+///
+/// @return reward of player 1: 1 = more points, 0.5 = same points, 0 = fewer
+//
+double rollout(MctsWorker* worker, EspGame* game)
+{
+  Move* moves = worker->moves_;
+  for (int turn = 0; turn < MCTS_ROLLOUT_MOVES && esp_is_over(game) == 0; turn++)
+  {
+    int count = esp_legal_moves(game, moves, ESP_MOVES_MAX);
+
+    // legal moves come as quit, draw, challenges, plays, swaps
+    int draw = -1, challenges = 0, plays = 0, swaps = 0;
+    int first = 1;
+    if (first < count && moves[first].kind_ == MOVE_DRAW)
+      draw = first++;
+    int challenge = first;
+    for (; first < count && moves[first].kind_ == MOVE_CHALLENGE; first++)
+      challenges++;
+    int play = first;
+    for (; first < count && moves[first].kind_ == MOVE_PLAY; first++)
+      plays++;
+    int swap = first;
+    swaps = count - first;
+
+    uint64_t roll = randomBelow(&worker->random_, 16);
+    int chosen = -1;
+    if (challenges > 0 && roll < 3)
+      chosen = challenge + (int)(roll % 2);
+    else if (plays > 0 && roll < 13)
+    {
+      chosen = play + (int)randomBelow(&worker->random_, (uint64_t)plays);
+      for (int attempt = 0; attempt < 2 && moves[chosen].real_card_ != moves[chosen].played_card_; attempt++)
+        chosen = play + (int)randomBelow(&worker->random_, (uint64_t)plays);
+    }
+    else if (draw >= 0)
+      chosen = draw;
+    else if (swaps > 0)
+      chosen = swap + (int)randomBelow(&worker->random_, (uint64_t)swaps);
+    else if (plays > 0)
+      chosen = play + (int)randomBelow(&worker->random_, (uint64_t)plays);
+    else if (challenges > 0)
+      chosen = challenge;
+    else
+      break;
+
+    esp_apply(game, &moves[chosen], NULL);
+  }
+
+  int scores[2];
+  esp_scores(game, scores);
+  return (scores[0] > scores[1]) ? 1.0 : (scores[0] == scores[1]) ? 0.5 : 0.0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Checking whether the search is out of time
+///
+/// @param deadline end of the search
+///
+/// @return true = the deadline has passed
+//
+static bool pastDeadline(struct timespec* deadline)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Random number below a bound, by multiplying instead of dividing
+///
+/// @param random random number state
+/// @param bound exclusive upper bound, not 0
+///
+/// @return number from 0 to bound - 1
+//
+static uint64_t randomBelow(uint64_t* random, uint64_t bound)
+{
+  return (uint64_t)(((unsigned __int128)nextRandom(random) * bound) >> 64);
+}
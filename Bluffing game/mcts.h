@@ -0,0 +1,118 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "main.h"
+
+#define MCTS_NODES_MAX 65536
+#define MCTS_POOL_CARDS 1024      // draw pile cards of a determinization, a power of two
+#define MCTS_ROLLOUT_MOVES 400
+#define MCTS_EXPLORATION 0.7
+#define MCTS_THREADS_MAX 64
+#define MCTS_PATH_MAX 128
+#define MCTS_UNSEEN_MAX (2 * CARD_KINDS * HAND_COPIES_MAX + 1 + MCTS_POOL_CARDS)
+
+// node of a search tree, reached by the move with key_ made by player_
+typedef struct _MctsNode_
+{
+  uint32_t child_;     // first child; 0 = none, node 0 is the root
+  uint32_t sibling_;
+  uint32_t visits_;
+  uint32_t available_; // times the move was legal when this node's parent was visited
+  float reward_;       // sum of the rewards of player_, 1 = won, 0.5 = draw
+  uint16_t key_;
+  uint8_t player_;
+} MctsNode;
+
+// move keys legal in one state with one move for each of them
+typedef struct _MctsChoices_
+{
+  uint16_t keys_[ESP_MOVES_MAX];
+  Move moves_[ESP_MOVES_MAX];
+  uint32_t seen_[ESP_MOVES_MAX]; // moves that fell under the key, for the random pick among them
+  int count_;
+  int16_t slots_[ESP_MOVE_INDICES]; // slot of a key in keys_; -1 = not legal
+} MctsChoices;
+
+struct _MctsBot_;
+
+// one thread of the search with its own tree, cards and random numbers
+typedef struct _MctsWorker_
+{
+  struct _MctsBot_* bot_;
+  MctsNode* nodes_;
+  uint32_t node_count_;
+  Card* unseen_;         // the unseen cards of the bot, shuffled by each determinization
+  Card* ring_;           // draw pile of the determinization
+  Move* moves_;          // ESP_MOVES_MAX
+  MctsChoices* choices_;
+  uint64_t random_;
+  unsigned long playouts_;
+} MctsWorker;
+
+// the bot of one seat, a search is run for every move it makes
+typedef struct _MctsBot_
+{
+  int budget_ms_;
+  int threads_;
+  Arena arena_;          // trees and buffers of all workers
+  MctsWorker* workers_;  // workers_[0] runs on the thread asking for the move
+  pthread_t* pool_;      // threads of the other workers
+  pthread_mutex_t lock_;
+  pthread_cond_t start_;
+  pthread_cond_t done_;
+  unsigned long generation_; // counts the searches, a new one starts the pool
+  int pending_;          // pool threads still searching
+  bool stop_;
+
+  // the search the workers run: the game as the bot sees it and its unseen cards
+  EspGame root_;
+  Card unseen_[MCTS_UNSEEN_MAX];
+  uint32_t unseen_count_;
+  int opponent_size_;
+  bool hidden_real_;     // the real card under the latest play is unseen
+  uint32_t pile_cards_;  // unseen cards that go onto the draw pile
+  struct timespec deadline_;
+
+  // the last card the bot played, so it knows the real card of its own play
+  int32_t known_played_;
+  Card known_claim_;
+  int known_points_;
+
+  unsigned long moves_;
+  unsigned long playouts_;
+  double seconds_;
+  char move_[BOT_MOVE_SIZE];
+} MctsBot;
+
+int parseMctsSeat(char* spec, int* budget_ms, int* threads);
+
+int initialiseMctsBot(MctsBot* bot, int budget_ms, int threads, uint64_t seed);
+
+void freeMctsBot(MctsBot* bot);
+
+void reportMctsBot(MctsBot* bot, int player, FILE* out);
+
+int mctsMove(void* context, TurnView* view, char** line);
+
+void prepareSearch(MctsBot* bot, EspGame* game);
+
+void *mctsThread(void* argument);
+
+void searchMcts(MctsWorker* worker);
+
+void determinize(MctsWorker* worker, EspGame* game);
+
+void listChoices(EspGame* game, Move* moves, int count, int bot_player, MctsChoices* choices, uint64_t* random);
+
+int moveKey(Move* move, bool observed_only);
+
+void concreteMove(EspGame* game, Move* move, uint64_t* random);
+
+double rollout(MctsWorker* worker, EspGame* game);
+
+#endif // MCTS_H
@@ -0,0 +1,344 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "runner.h"
+
+//------------------------------------------------------------------------------
+///
+/// Plays --simulate games between random bots on a pool of threads. The games
+/// are split evenly between the workers, a worker that runs out steals half of
+/// the games another worker has left. Every worker plays on its own engine,
+/// session and bots and counts into its own GameStats, the counters are only
+/// added up after all workers are joined. The bots of game n are seeded by the
+/// seed and n and --shuffle shuffles by the shuffle seed and n, so the results
+/// do not depend on the number of threads
+///
+/// @param options parsed options with the games, threads, seeds and config file
+///
+/// @return 1 = wrong usage; 2 = file not open; 3 = not a valid file;
+///         4 = alloc fail; 0 = End
+//
+int runGames(Options* options)
+{
+  if (options->games_ > UINT32_MAX || options->threads_ > RUNNER_THREADS_MAX)
+  {
+    printf("%s", USAGE);
+    return WRONG_USAGE;
+  }
+  int workers = options->threads_;
+  uint32_t games = (uint32_t)options->games_;
+
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int load_check = loadDeck(options->config_name_, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  // queues, workers, threads and the decks of --shuffle live in one arena for the whole run
+  size_t deck_bytes = options->shuffle_ ? ((deck.size_ + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1)) : 0;
+  Arena arena;
+  bool out_of_memory = initialiseArena(&arena, (size_t)workers * (sizeof(GameQueue) + sizeof(Worker) +
+    sizeof(pthread_t) + deck_bytes + 3 * ARENA_ALIGN)) != 0;
+  GameQueue* queues = out_of_memory ? NULL : (GameQueue*)arenaAlloc(&arena, (size_t)workers * sizeof(GameQueue));
+  Worker* pool = out_of_memory ? NULL : (Worker*)arenaAlloc(&arena, (size_t)workers * sizeof(Worker));
+  pthread_t* threads = out_of_memory ? NULL : (pthread_t*)arenaAlloc(&arena, (size_t)workers * sizeof(pthread_t));
+
+  int started = 0;
+  for (int index = 0; index < workers && !out_of_memory; index++)
+  {
+    uint64_t first = (uint64_t)games * (uint64_t)index / (uint64_t)workers;
+    uint64_t end = (uint64_t)games * (uint64_t)(index + 1) / (uint64_t)workers;
+    atomic_init(&queues[index].range_, (first << 32) | end);
+
+    Worker* worker = &pool[index];
+    worker->index_ = index;
+    worker->workers_ = workers;
+    worker->queues_ = queues;
+    worker->deck_ = &deck;
+    worker->shuffled_ = (DrawPile){ NULL, 0, 0, 0 };
+    worker->options_ = options;
+    worker->status_ = 0;
+    initialiseStats(&worker->stats_);
+    if (options->shuffle_)
+    {
+      worker->shuffled_.cards_ = (Card*)arenaAlloc(&arena, deck.size_);
+      worker->shuffled_.size_ = deck.size_;
+    }
+    started = index + 1;
+  }
+
+  struct timespec start, finish;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  // the queues of workers that could not be started are stolen by the others
+  int running = 0;
+  while (!out_of_memory && running < started &&
+         pthread_create(&threads[running], NULL, runWorker, &pool[running]) == 0)
+    running++;
+  out_of_memory = out_of_memory || running == 0;
+  for (int index = 0; index < running; index++)
+    pthread_join(threads[index], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+
+  GameStats total;
+  initialiseStats(&total);
+  for (int index = 0; index < started; index++)
+  {
+    out_of_memory = out_of_memory || pool[index].status_ == ALLOC_FAIL;
+    mergeStats(&total, &pool[index].stats_);
+  }
+  freeArena(&arena);
+  freeCards(&deck);
+  if (out_of_memory)
+  {
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  double seconds = (double)(finish.tv_sec - start.tv_sec) + (double)(finish.tv_nsec - start.tv_nsec) / 1e9;
+  printf("Simulated %lu games on %d threads in %.3f s (%.0f games/sec)\n", total.games_, workers, seconds,
+    (seconds > 0) ? (double)total.games_ / seconds : 0.0);
+  printStats(&total);
+  return GAME_END;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Thread of the runner. Plays the games of its own queue and steals more
+/// when it is empty, until no worker has games left
+///
+/// @param argument Worker of the thread
+///
+/// @return NULL
+//
+void *runWorker(void* argument)
+{
+  Worker* worker = (Worker*)argument;
+  Options* options = worker->options_;
+  DrawPile* deck = worker->options_->shuffle_ ? &worker->shuffled_ : worker->deck_;
+
+  Renderer renderer;
+  initialiseRenderer(&renderer, RENDER_OFF, stdout);
+  RandomBot bots[2];
+  Session session;
+  initialiseSession(&session, NULL, &renderer);
+  session.stats_ = &worker->stats_;
+  for (int seat = 0; seat < 2; seat++)
+  {
+    session.seats_[seat].provide_ = randomMove;
+    session.seats_[seat].context_ = &bots[seat];
+  }
+
+  uint32_t game_index;
+  while (takeGame(worker, &game_index) || (stealGames(worker) && takeGame(worker, &game_index)))
+  {
+    for (int seat = 0; seat < 2; seat++)
+      bots[seat].state_ = counterRandom(options->seed_, game_index, (uint64_t)seat);
+    if (deck == &worker->shuffled_)
+    {
+      memcpy(deck->cards_, worker->deck_->cards_, deck->size_);
+      shuffleCards(deck->cards_, deck->size_, options->shuffle_seed_, game_index);
+    }
+
+    EspGame game;
+    esp_game_init(&game, deck);
+    session.turns_ = 0;
+    int gameplay_checker = gameplay(&session, &game);
+    if (gameplay_checker == ALLOC_FAIL)
+    {
+      worker->status_ = ALLOC_FAIL;
+      break;
+    }
+    recordGame(&worker->stats_, &game.state_.players_[0], &game.state_.players_[1], session.turns_);
+  }
+
+  freeRenderer(&renderer);
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Takes the next game from the front of the own queue
+///
+/// @param worker worker taking the game
+/// @param game index of the game taken
+///
+/// @return true = a game was taken; false = the queue is empty
+//
+bool takeGame(Worker* worker, uint32_t* game)
+{
+  GameQueue* queue = &worker->queues_[worker->index_];
+  uint64_t range = atomic_load_explicit(&queue->range_, memory_order_relaxed);
+  while ((uint32_t)(range >> 32) < (uint32_t)range)
+  {
+    if (atomic_compare_exchange_weak_explicit(&queue->range_, &range, range + ((uint64_t)1 << 32),
+        memory_order_relaxed, memory_order_relaxed))
+    {
+      *game = (uint32_t)(range >> 32);
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Moves the back half of the games of another worker into the empty own
+/// queue, trying the workers after this one in turn. Games only ever move
+/// between queues, so a worker that finds every queue empty is done
+///
+/// @param worker worker with an empty queue
+///
+/// @return true = games were stolen; false = no worker has games left
+//
+bool stealGames(Worker* worker)
+{
+  for (int offset = 1; offset < worker->workers_; offset++)
+  {
+    GameQueue* victim = &worker->queues_[(worker->index_ + offset) % worker->workers_];
+    uint64_t range = atomic_load_explicit(&victim->range_, memory_order_relaxed);
+    while ((uint32_t)(range >> 32) < (uint32_t)range)
+    {
+      uint32_t next = (uint32_t)(range >> 32);
+      uint32_t end = (uint32_t)range;
+      uint32_t split = end - (end - next + 1) / 2;
+      if (atomic_compare_exchange_weak_explicit(&victim->range_, &range, ((uint64_t)next << 32) | split,
+          memory_order_relaxed, memory_order_relaxed))
+      {
+        atomic_store_explicit(&worker->queues_[worker->index_].range_, ((uint64_t)split << 32) | end,
+          memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Initialising the counters of a run
+///
+/// @param stats counters to initialise
+///
+/// @return no return
+//
+void initialiseStats(GameStats* stats)
+{
+  memset(stats, 0, sizeof(GameStats));
+  stats->shortest_ = (unsigned long)-1;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Counting a finished game
+///
+/// @param stats counters of the worker
+/// @param p1 player 1 at the end of the game
+/// @param p2 player 2 at the end of the game
+/// @param turns turns of the game
+///
+/// @return no return
+//
+void recordGame(GameStats* stats, Player* p1, Player* p2, unsigned long turns)
+{
+  stats->games_++;
+  if (p1->points_ == p2->points_)
+    stats->wins_[0]++;
+  else
+    stats->wins_[(p1->points_ > p2->points_) ? 1 : 2]++;
+
+  Player* players[2] = { p1, p2 };
+  for (int seat = 0; seat < 2; seat++)
+  {
+    int points = players[seat]->points_;
+    int bucket = (points < 0) ? 0 : points / SCORE_BUCKET_WIDTH;
+    stats->scores_[seat][(bucket < SCORE_BUCKETS) ? bucket : SCORE_BUCKETS - 1]++;
+    stats->points_[seat] += points;
+  }
+
+  stats->turns_ += turns;
+  stats->shortest_ = (turns < stats->shortest_) ? turns : stats->shortest_;
+  stats->longest_ = (turns > stats->longest_) ? turns : stats->longest_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Adding the counters of one worker to the total
+///
+/// @param total counters of the run
+/// @param stats counters of the worker
+///
+/// @return no return
+//
+void mergeStats(GameStats* total, GameStats* stats)
+{
+  total->games_ += stats->games_;
+  for (int index = 0; index < 3; index++)
+  {
+    total->wins_[index] += stats->wins_[index];
+    total->challenges_[index] += stats->challenges_[index];
+    total->successes_[index] += stats->successes_[index];
+  }
+  for (int seat = 0; seat < 2; seat++)
+  {
+    total->points_[seat] += stats->points_[seat];
+    for (int bucket = 0; bucket < SCORE_BUCKETS; bucket++)
+      total->scores_[seat][bucket] += stats->scores_[seat][bucket];
+  }
+  total->turns_ += stats->turns_;
+  total->shortest_ = (stats->shortest_ < total->shortest_) ? stats->shortest_ : total->shortest_;
+  total->longest_ = (stats->longest_ > total->longest_) ? stats->longest_ : total->longest_;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Final points a fraction of the games of a seat stayed below, as the lowest
+/// points of its bucket
+///
+/// @param stats counters of the run
+/// @param seat 0 = player 1; 1 = player 2
+/// @param fraction 0.5 = median
+///
+/// @return points
+//
+int scorePercentile(GameStats* stats, int seat, double fraction)
+{
+  unsigned long rank = (unsigned long)((double)stats->games_ * fraction);
+  unsigned long counted = 0;
+  for (int bucket = 0; bucket < SCORE_BUCKETS; bucket++)
+  {
+    counted += stats->scores_[seat][bucket];
+    if (counted > rank)
+      return bucket * SCORE_BUCKET_WIDTH;
+  }
+  return (SCORE_BUCKETS - 1) * SCORE_BUCKET_WIDTH;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Printing the counters of a run
+///
+/// @param stats counters of the run
+///
+/// @return no return
+//
+void printStats(GameStats* stats)
+{
+  printf("Player 1 wins: %lu\nPlayer 2 wins: %lu\nDraws: %lu\n", stats->wins_[1], stats->wins_[2], stats->wins_[0]);
+  if (stats->games_ == 0)
+    return;
+
+  printf("Game length: %.1f turns on average, shortest %lu, longest %lu\n",
+    (double)stats->turns_ / (double)stats->games_, stats->shortest_, stats->longest_);
+  for (int seat = 0; seat < 2; seat++)
+    printf("Player %d points: %.1f on average, median %d, 90th percentile %d\n", seat + 1,
+      (double)stats->points_[seat] / (double)stats->games_, scorePercentile(stats, seat, 0.5),
+      scorePercentile(stats, seat, 0.9));
+
+  const char* names[3] = { NULL, "Spice", "Value" };
+  for (int type = CHALLENGE_SPICE; type <= CHALLENGE_VALUE; type++)
+    printf("%s challenges: %lu, %.1f%% successful\n", names[type], stats->challenges_[type],
+      (stats->challenges_[type] > 0) ? 100.0 * (double)stats->successes_[type] / (double)stats->challenges_[type] : 0.0);
+}
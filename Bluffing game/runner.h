@@ -0,0 +1,51 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "main.h"
+
+#define RUNNER_THREADS_MAX 256
+#define CACHE_LINE 64
+
+// games of one worker still to play, next in the high and end in the low 32 bits.
+// The owner takes games from the front, thieves take the back half
+typedef struct _GameQueue_
+{
+  _Alignas(CACHE_LINE) _Atomic uint64_t range_;
+} GameQueue;
+
+// everything one thread of the runner touches while it plays
+typedef struct _Worker_
+{
+  _Alignas(CACHE_LINE) int index_;
+  int workers_;
+  GameQueue* queues_;   // queues of all workers, queues_[index_] is the own one
+  DrawPile* deck_;      // shared and read-only unless the worker shuffles its own copy
+  DrawPile shuffled_;   // copy of the deck for --shuffle, empty otherwise
+  Options* options_;
+  GameStats stats_;
+  int status_;          // 0 = all games played; 4 = alloc fail
+} Worker;
+
+int runGames(Options* options);
+
+void *runWorker(void* argument);
+
+bool takeGame(Worker* worker, uint32_t* game);
+
+bool stealGames(Worker* worker);
+
+void initialiseStats(GameStats* stats);
+
+void recordGame(GameStats* stats, Player* p1, Player* p2, unsigned long turns);
+
+void mergeStats(GameStats* total, GameStats* stats);
+
+int scorePercentile(GameStats* stats, int seat, double fraction);
+
+void printStats(GameStats* stats);
+
+#endif // RUNNER_H
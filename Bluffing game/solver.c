@@ -0,0 +1,534 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "solver.h"
+
+static int orderMoves(EspGame* game, Move* moves, int count, int first_index, int16_t* order);
+static bool sameMove(Move* move, Move* other);
+static uint64_t packEntry(int value, int depth, int bound, int move_index, bool history);
+
+//------------------------------------------------------------------------------
+///
+/// Solving a game with both hands and the draw pile known to both players.
+/// The threads deepen an alpha-beta search together and share one
+/// transposition table (lazy SMP), the first thread's result is printed
+/// with the principal variation. A search that reaches every end of the
+/// game without cutting a line at a repeated game is exact, otherwise the
+/// result is that of the deepest search
+///
+/// @param config_name config file or binary deck
+/// @param save_name save file to solve from; NULL = start of the game
+/// @param max_depth moves to look ahead at most
+/// @param threads searching threads
+///
+/// @return 1 = wrong usage; 2 = file not open; 3 = not a valid file;
+///         4 = alloc fail; 0 = End
+//
+int solveGame(char* config_name, char* save_name, int max_depth, int threads)
+{
+  if (max_depth <= 0 || max_depth > SOLVER_DEPTH_MAX || threads <= 0 || threads > SOLVER_THREADS_MAX)
+  {
+    printf("%s", USAGE);
+    return WRONG_USAGE;
+  }
+
+  DrawPile deck = { NULL, 0, 0, 0 };
+  int load_check = loadDeck(config_name, &deck);
+  if (load_check != 0)
+    return load_check;
+
+  EspGame game;
+  esp_game_init(&game, &deck);
+  if (save_name != NULL)
+  {
+    load_check = loadGame(save_name, &game, &deck);
+    if (load_check != 0)
+    {
+      freeCards(&deck);
+      printf(load_check == 1 ? "Error: Cannot open file: %s\n" : "Error: Invalid save file: %s\n", save_name);
+      return load_check == 1 ? CANT_OPEN_FILE : INVALID_FILE;
+    }
+  }
+
+  // table, keys, threads and their games live in one arena
+  size_t table_bytes = ((size_t)1 << SOLVER_TABLE_BITS) * sizeof(SolverEntry);
+  size_t key_bytes = SOLVER_KEY_BYTES * 256 * sizeof(uint64_t);
+  Arena arena;
+  if (initialiseArena(&arena, table_bytes + key_bytes + (size_t)threads * (sizeof(SolverThread) +
+      sizeof(pthread_t) + sizeof(bool) + 3 * ARENA_ALIGN) + 3 * ARENA_ALIGN) != 0)
+  {
+    freeCards(&deck);
+    printf("Error: Out of memory\n");
+    return ALLOC_FAIL;
+  }
+
+  SolverEntry* table = (SolverEntry*)arenaAlloc(&arena, table_bytes);
+  memset((void*)table, 0, table_bytes);
+  uint64_t (*keys)[256] = (uint64_t (*)[256])arenaAlloc(&arena, key_bytes);
+  uint64_t random = 1;
+  for (int byte = 0; byte < SOLVER_KEY_BYTES; byte++)
+  {
+    for (int value = 0; value < 256; value++)
+      keys[byte][value] = nextRandom(&random);
+  }
+  SolverThread* solvers = (SolverThread*)arenaAlloc(&arena, (size_t)threads * sizeof(SolverThread));
+  pthread_t* pool = (pthread_t*)arenaAlloc(&arena, (size_t)threads * sizeof(pthread_t));
+  bool* started = (bool*)arenaAlloc(&arena, (size_t)threads * sizeof(bool));
+  _Atomic bool stop = false;
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int index = 0; index < threads; index++)
+  {
+    SolverThread* solver = &solvers[index];
+    solver->index_ = index;
+    esp_game_clone(&solver->game_, &game);
+    solver->table_ = table;
+    solver->keys_ = keys;
+    solver->stop_ = &stop;
+    solver->max_depth_ = max_depth;
+    solver->nodes_ = 0;
+    solver->depth_ = 0;
+    solver->value_ = 0;
+    solver->complete_ = false;
+    solver->repeated_ = false;
+    started[index] = index > 0 && pthread_create(&pool[index], NULL, runSolverThread, solver) == 0;
+  }
+
+  // a helper that could not be started is left out, the first thread does the work alone
+  deepenSolver(&solvers[0]);
+  atomic_store(&stop, true);
+  unsigned long nodes = solvers[0].nodes_;
+  for (int index = 1; index < threads; index++)
+  {
+    if (started[index])
+    {
+      pthread_join(pool[index], NULL);
+      nodes += solvers[index].nodes_;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+  int scores[2];
+  esp_scores(&game, scores);
+  int lead = (game.state_.curr_player_ == 1) ? solvers[0].value_ : -solvers[0].value_;
+  printf("Searched %lu nodes on %d threads in %.3f s (%.1f M nodes/sec)\n", nodes, threads, seconds,
+    (seconds > 0) ? (double)nodes / seconds / 1e6 : 0.0);
+  if (solvers[0].complete_ && !solvers[0].repeated_)
+    printf("Score difference (player 1 - player 2): %+d, exact (searched %d moves deep)\n",
+      scores[0] - scores[1] + lead, solvers[0].depth_);
+  else if (solvers[0].complete_)
+    printf("Score difference (player 1 - player 2): %+d, not exact, lines that repeat a game were cut "
+      "(searched %d moves deep)\n", scores[0] - scores[1] + lead, solvers[0].depth_);
+  else
+    printf("Score difference (player 1 - player 2): %+d, not exact, searched %d moves deep\n",
+      scores[0] - scores[1] + lead, solvers[0].depth_);
+  printVariation(&solvers[0]);
+
+  freeArena(&arena);
+  freeCards(&deck);
+  return GAME_END;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Thread of a helper, deepens the search until the first thread is done
+///
+/// @param argument SolverThread of the thread
+///
+/// @return NULL
+//
+void *runSolverThread(void* argument)
+{
+  deepenSolver((SolverThread*)argument);
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Searching one move deeper at a time until a search reaches every end of
+/// the game or max_depth_. Every second helper starts a move deeper, so the
+/// threads run ahead of each other and leave their results in the table
+///
+/// @param thread thread with the game at the root
+///
+/// @return no return
+//
+void deepenSolver(SolverThread* thread)
+{
+  for (int depth = 1 + (thread->index_ & 1); depth <= thread->max_depth_; depth++)
+  {
+    bool complete = false;
+    bool repeated = false;
+    int value = solveNode(thread, depth, -SOLVER_INFINITY, SOLVER_INFINITY, 0, &complete, &repeated);
+    if (thread->index_ > 0 && atomic_load_explicit(thread->stop_, memory_order_relaxed))
+      return;
+
+    thread->depth_ = depth;
+    thread->value_ = value;
+    thread->complete_ = complete;
+    thread->repeated_ = repeated;
+    if (complete)
+      return;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Alpha-beta search of the points the player in turn gains from here on
+/// more than the opponent. Points already scored do not count, so a game
+/// is worth the same however it was reached. Ended games are worth 0, and so
+/// is a game that repeats one earlier on the path, since swapping back and
+/// forth never ends. A value that depends on such a cut depends on the path,
+/// so it is stored as a history entry that only orders the moves of later
+/// searches. Quit is not searched
+///
+/// @param thread thread with the game to search, the same again on return
+/// @param depth moves to look ahead
+/// @param alpha value the player in turn already has
+/// @param beta value the opponent already has, negated
+/// @param ply moves from the root
+/// @param complete set to whether every end of the game was reached
+/// @param repeated set to whether a line was cut at a repeated game
+///
+/// @return value for the player in turn; 0 once the search was stopped
+//
+int solveNode(SolverThread* thread, int depth, int alpha, int beta, int ply, bool* complete, bool* repeated)
+{
+  EspGame* game = &thread->game_;
+  *complete = true;
+  *repeated = false;
+  if (esp_is_over(game) != 0)
+    return 0;
+
+  uint64_t hash = solverHash(thread);
+  thread->path_[ply] = hash;
+  for (int earlier = ply - 1; earlier >= 0; earlier--)
+  {
+    if (thread->path_[earlier] == hash)
+    {
+      *repeated = true;
+      return 0;
+    }
+  }
+
+  *complete = false;
+  if ((++thread->nodes_ & 1023) == 0 && thread->index_ > 0 &&
+      atomic_load_explicit(thread->stop_, memory_order_relaxed))
+    return 0;
+  if (depth == 0)
+    return 0;
+
+  uint64_t data;
+  int first_index = -1;
+  if (probeSolver(thread->table_, hash, &data))
+  {
+    int value = (int32_t)(uint32_t)data;
+    int stored_depth = (int)((data >> 32) & 0xFF);
+    int bound = (int)((data >> 40) & 3);
+    bool history = (data >> 58) & 1;
+    first_index = (int)((data >> 42) & 0xFFFF) - 1;
+    if (!history && stored_depth >= depth && (bound == SOLVER_EXACT || (bound == SOLVER_LOWER && value >= beta) ||
+        (bound == SOLVER_UPPER && value <= alpha)))
+    {
+      *complete = stored_depth == SOLVER_DEPTH_COMPLETE;
+      return value;
+    }
+  }
+
+  Move moves[ESP_MOVES_MAX];
+  int16_t order[ESP_MOVES_MAX];
+  int count = orderMoves(game, moves, esp_legal_moves(game, moves, ESP_MOVES_MAX), first_index, order);
+
+  int mover = game->state_.curr_player_;
+  int alpha_start = alpha;
+  int best = -SOLVER_INFINITY;
+  int best_index = -1;
+  bool all_complete = true;
+  bool any_repeated = false;
+  for (int i = 0; i < count; i++)
+  {
+    Move* move = &moves[order[i]];
+    int before[2], after[2];
+    esp_scores(game, before);
+    EspUndo undo;
+    esp_make(game, move, NULL, &undo);
+    esp_scores(game, after);
+
+    // a challenge can leave the same player in turn for the next round
+    int gain = (after[mover - 1] - before[mover - 1]) - (after[2 - mover] - before[2 - mover]);
+    bool child_complete, child_repeated;
+    int value = gain + ((game->state_.curr_player_ == mover) ?
+      solveNode(thread, depth - 1, alpha - gain, beta - gain, ply + 1, &child_complete, &child_repeated) :
+      -solveNode(thread, depth - 1, gain - beta, gain - alpha, ply + 1, &child_complete, &child_repeated));
+    esp_unmake(game, &undo);
+
+    if (thread->index_ > 0 && atomic_load_explicit(thread->stop_, memory_order_relaxed))
+      return 0;
+    all_complete = all_complete && child_complete;
+    any_repeated = any_repeated || child_repeated;
+    if (value > best)
+    {
+      best = value;
+      best_index = esp_move_index(game, move);
+    }
+    if (value > alpha)
+      alpha = value;
+    if (alpha >= beta)
+      break;
+  }
+
+  *complete = all_complete;
+  *repeated = any_repeated;
+  if (count == 0)
+    return 0;
+
+  int bound = (best >= beta) ? SOLVER_LOWER : (best <= alpha_start) ? SOLVER_UPPER : SOLVER_EXACT;
+  storeSolver(thread->table_, hash, best, (all_complete && !any_repeated) ? SOLVER_DEPTH_COMPLETE : depth, bound,
+    best_index, any_repeated);
+  return best;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Zobrist hash of the game: the hands, the draw pile position and the round
+/// packed into SOLVER_KEY_BYTES bytes, one key for the value of every byte.
+/// The points are left out, see solveNode
+///
+/// @param thread thread with the game and the keys
+///
+/// @return hash
+//
+uint64_t solverHash(SolverThread* thread)
+{
+  GameState* state = &thread->game_.state_;
+  uint8_t packed[SOLVER_KEY_BYTES];
+  memcpy(packed, state->players_[0].hand_.counts_, sizeof(Hand));
+  memcpy(packed + 20, state->players_[1].hand_.counts_, sizeof(Hand));
+  memcpy(packed + 40, &state->pile_next_, 4);
+  memcpy(packed + 44, &state->cards_played_, 4);
+  packed[48] = state->curr_player_;
+  packed[49] = state->last_action_;
+  packed[50] = (uint8_t)state->curr_spice_;
+  packed[51] = state->latest_played_card_;
+  packed[52] = state->latest_real_card_;
+  packed[53] = state->last_round_loser_;
+  packed[54] = (uint8_t)state->result_;
+
+  uint64_t hash = 0;
+  for (int byte = 0; byte < SOLVER_KEY_BYTES; byte++)
+    hash ^= thread->keys_[byte][packed[byte]];
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Looking a game up in the transposition table. A bucket is the two
+/// entries at an even index
+///
+/// @param table transposition table
+/// @param hash hash of the game
+/// @param data data of the entry found
+///
+/// @return true = found
+//
+bool probeSolver(SolverEntry* table, uint64_t hash, uint64_t* data)
+{
+  SolverEntry* bucket = &table[hash & ((((uint64_t)1 << SOLVER_TABLE_BITS) - 1) & ~(uint64_t)1)];
+  for (int slot = 0; slot < 2; slot++)
+  {
+    uint64_t found = atomic_load_explicit(&bucket[slot].data_, memory_order_relaxed);
+    if ((atomic_load_explicit(&bucket[slot].check_, memory_order_relaxed) ^ found) == hash && found != 0)
+    {
+      *data = found;
+      return true;
+    }
+  }
+  return false;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Storing a searched game. The first entry of the bucket keeps the deepest
+/// search, the second one takes whatever the first one does not
+///
+/// @param table transposition table
+/// @param hash hash of the game
+/// @param value value of the search
+/// @param depth depth of the search; SOLVER_DEPTH_COMPLETE = every end reached
+/// @param bound SOLVER_*
+/// @param move_index move index of the best move; -1 = none
+/// @param history the value depends on the path, only the move may be used
+///
+/// @return no return
+//
+void storeSolver(SolverEntry* table, uint64_t hash, int value, int depth, int bound, int move_index, bool history)
+{
+  SolverEntry* bucket = &table[hash & ((((uint64_t)1 << SOLVER_TABLE_BITS) - 1) & ~(uint64_t)1)];
+  uint64_t kept = atomic_load_explicit(&bucket[0].data_, memory_order_relaxed);
+  bool same = (atomic_load_explicit(&bucket[0].check_, memory_order_relaxed) ^ kept) == hash;
+  SolverEntry* entry = (same || (int)((kept >> 32) & 0xFF) <= depth) ? &bucket[0] : &bucket[1];
+
+  uint64_t data = packEntry(value, depth, bound, move_index, history);
+  atomic_store_explicit(&entry->data_, data, memory_order_relaxed);
+  atomic_store_explicit(&entry->check_, hash ^ data, memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Printing the moves both players make when they play the best moves found,
+/// as far as the table knows them
+///
+/// @param thread first thread, its game is at the root
+///
+/// @return no return
+//
+void printVariation(SolverThread* thread)
+{
+  EspGame* game = &thread->game_;
+  EspGame root;
+  esp_game_clone(&root, game);
+
+  printf("Principal variation:\n");
+  int ply = 0;
+  for (; ply < SOLVER_PLY_MAX && esp_is_over(game) == 0; ply++)
+  {
+    uint64_t hash = solverHash(thread);
+    thread->path_[ply] = hash;
+    bool repeated = false;
+    for (int earlier = 0; earlier < ply; earlier++)
+      repeated = repeated || thread->path_[earlier] == hash;
+
+    uint64_t data;
+    if (repeated || !probeSolver(thread->table_, hash, &data) || ((data >> 42) & 0xFFFF) == 0)
+    {
+      printf("%s\n", repeated ? "  (the game repeats from here on)" : "  (not searched further)");
+      break;
+    }
+
+    Move move;
+    esp_index_move(game, (int)((data >> 42) & 0xFFFF) - 1, &move);
+    int player = game->state_.curr_player_;
+    int before[2], after[2];
+    esp_scores(game, before);
+    EspUndo undo;
+    if (esp_make(game, &move, NULL, &undo) != ERROR_NONE)
+    {
+      printf("  (not searched further)\n");
+      break;
+    }
+    esp_scores(game, after);
+
+    char line[BOT_MOVE_SIZE];
+    formatMove(&move, line);
+    printf("%4d. Player %d: %s", ply + 1, player, line);
+    for (int scorer = 0; scorer < 2; scorer++)
+    {
+      if (after[scorer] != before[scorer])
+        printf("  (player %d +%d)", scorer + 1, after[scorer] - before[scorer]);
+    }
+    printf("\n");
+  }
+
+  int scores[2];
+  esp_scores(game, scores);
+  printf("Points after %d moves: %d - %d%s\n", ply, scores[0], scores[1],
+    (esp_is_over(game) != 0) ? ", game over" : "");
+  esp_game_clone(game, &root);
+}
+
+//------------------------------------------------------------------------------
+///
+/// Ordering the legal moves but quit for the search: the best move of the
+/// table first, then challenges and plays, which end rounds and empty hands,
+/// then draw and swaps last. Swaps lead to long chains of hands that only
+/// end in repetitions, so searching them early keeps a search from ending
+///
+/// @param game game the moves are legal in
+/// @param moves legal moves as esp_legal_moves lists them
+/// @param count number of legal moves
+/// @param first_index move index to search first; -1 = none
+/// @param order indices into moves in search order
+///
+/// @return number of moves in order
+//
+static int orderMoves(EspGame* game, Move* moves, int count, int first_index, int16_t* order)
+{
+  Move first;
+  if (first_index >= 0)
+    esp_index_move(game, first_index, &first);
+
+  int size = 0;
+  int16_t found = -1;
+  for (int pass = 0; pass < 3; pass++)
+  {
+    for (int i = 1; i < count; i++)
+    {
+      int kind_pass = (moves[i].kind_ == MOVE_SWAP) ? 2 : (moves[i].kind_ == MOVE_DRAW) ? 1 : 0;
+      if (kind_pass != pass)
+        continue;
+      if (found < 0 && first_index >= 0 && sameMove(&moves[i], &first))
+        found = (int16_t)i;
+      else
+        order[size++] = (int16_t)i;
+    }
+  }
+
+  if (found >= 0)
+  {
+    memmove(order + 1, order, (size_t)size * sizeof(int16_t));
+    order[0] = found;
+    size++;
+  }
+  return size;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Comparing the parts of two moves that esp_make reads
+///
+/// @param move move
+/// @param other other move
+///
+/// @return true = same move
+//
+static bool sameMove(Move* move, Move* other)
+{
+  if (move->kind_ != other->kind_)
+    return false;
+  switch (move->kind_)
+  {
+    case MOVE_PLAY:
+      return move->real_card_ == other->real_card_ && move->played_card_ == other->played_card_;
+    case MOVE_CHALLENGE:
+      return move->challenge_ == other->challenge_;
+    case MOVE_SWAP:
+      return move->real_card_ == other->real_card_ && move->swap_index_ == other->swap_index_;
+    default:
+      return true;
+  }
+}
+
+//------------------------------------------------------------------------------
+///
+/// Packing an entry into 64 bits: the value in bits 0-31, the depth in 32-39,
+/// the bound in 40-41, the move index + 1 in 42-57 and the history flag in
+/// bit 58. An entry is never 0
+///
+/// @param value value
+/// @param depth depth of the search
+/// @param bound SOLVER_*
+/// @param move_index move index; -1 = none
+/// @param history the value depends on the path
+///
+/// @return entry data
+//
+static uint64_t packEntry(int value, int depth, int bound, int move_index, bool history)
+{
+  return (uint64_t)(uint32_t)value | (uint64_t)(depth & 0xFF) << 32 | (uint64_t)(bound & 3) << 40 |
+    (uint64_t)(move_index + 1) << 42 | (uint64_t)history << 58;
+}
@@ -0,0 +1,67 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "main.h"
+
+#define SOLVER_TABLE_BITS 22        // 2^22 entries of 16 bytes, 64 MB
+#define SOLVER_DEPTH_MAX 250
+#define SOLVER_DEPTH_COMPLETE 255   // depth of an entry whose whole subtree was searched, no repetition cut
+#define SOLVER_PLY_MAX (SOLVER_DEPTH_MAX + 2)
+#define SOLVER_INFINITY (1 << 30)
+#define SOLVER_THREADS_MAX 64
+#define SOLVER_KEY_BYTES 55         // bytes of the packed state, see solverHash
+
+// bound of a stored value
+enum {
+  SOLVER_EXACT,
+  SOLVER_LOWER,   // the value is at least this, the search cut off
+  SOLVER_UPPER    // the value is at most this, no move reached alpha
+};
+
+// transposition table entry. check_ is the key xor data_, a torn entry that
+// one thread read while another wrote it fails the check and is a miss
+typedef struct _SolverEntry_
+{
+  _Atomic uint64_t check_;
+  _Atomic uint64_t data_;   // value, depth, bound and best move index, see packEntry
+} SolverEntry;
+
+// one searching thread with its own copy of the game, the threads share the table
+typedef struct _SolverThread_
+{
+  _Alignas(ARENA_ALIGN) int index_;
+  EspGame game_;
+  SolverEntry* table_;
+  uint64_t (*keys_)[256];   // SOLVER_KEY_BYTES Zobrist keys for every byte value
+  _Atomic bool* stop_;
+  int max_depth_;
+  uint64_t path_[SOLVER_PLY_MAX]; // hashes of the games from the root to the node
+  unsigned long nodes_;
+  int depth_;               // last depth searched to the end
+  int value_;
+  bool complete_;
+  bool repeated_;           // a line of the last search was cut at a repeated game
+} SolverThread;
+
+int solveGame(char* config_name, char* save_name, int max_depth, int threads);
+
+void *runSolverThread(void* argument);
+
+void deepenSolver(SolverThread* thread);
+
+int solveNode(SolverThread* thread, int depth, int alpha, int beta, int ply, bool* complete, bool* repeated);
+
+uint64_t solverHash(SolverThread* thread);
+
+bool probeSolver(SolverEntry* table, uint64_t hash, uint64_t* data);
+
+void storeSolver(SolverEntry* table, uint64_t hash, int value, int depth, int bound, int move_index, bool history);
+
+void printVariation(SolverThread* thread);
+
+#endif // SOLVER_H
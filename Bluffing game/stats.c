@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+#include "stats.h"
+
+#ifdef ESP_STATS
+_Thread_local PhaseStats phase_stats[PHASE_COUNT];
+volatile sig_atomic_t stats_requested = 0;
+
+static const char* PHASE_NAMES[PHASE_COUNT] = { "input", "parse", "apply", "render", "refill", "persist" };
+
+//------------------------------------------------------------------------------
+///
+/// SIGUSR1 handler, only asks for the summary. It is printed by STATS_POLL
+/// at the next turn or while waiting for input
+///
+/// @param signal_number SIGUSR1
+///
+/// @return no return
+//
+static void requestPhaseStats(int signal_number)
+{
+  (void)signal_number;
+  stats_requested = 1;
+}
+#endif
+
+//------------------------------------------------------------------------------
+///
+/// Printing the summary on SIGUSR1 from now on. The handler is installed
+/// without SA_RESTART, so a read waiting for input returns to the poll
+///
+/// @return 1 = not built with -DESP_STATS or no handler; 0 = Valid
+//
+int installStatsSignal(void)
+{
+#ifdef ESP_STATS
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = requestPhaseStats;
+  sigemptyset(&action.sa_mask);
+  return (sigaction(SIGUSR1, &action, NULL) == 0) ? 0 : 1;
+#else
+  return 1;
+#endif
+}
+
+//------------------------------------------------------------------------------
+///
+/// Printing calls, time and allocations of every phase of the calling thread
+/// after the output of the game so far
+///
+/// @param out stream to print to
+///
+/// @return no return
+//
+void printPhaseStats(FILE* out)
+{
+  fflush(stdout); // after the game output printed so far
+#ifdef ESP_STATS
+#ifdef __x86_64__
+  const char* unit = "cycles";
+#else
+  const char* unit = "ns";
+#endif
+  fprintf(out, "%-8s %12s %16s %12s %12s\n", "phase", "calls", unit, "per call", "allocations");
+  for (int phase = 0; phase < PHASE_COUNT; phase++)
+  {
+    PhaseStats* stats = &phase_stats[phase];
+    fprintf(out, "%-8s %12llu %16llu %12.1f %12llu\n", PHASE_NAMES[phase], (unsigned long long)stats->calls_,
+      (unsigned long long)stats->ticks_, (stats->calls_ > 0) ? (double)stats->ticks_ / (double)stats->calls_ : 0.0,
+      (unsigned long long)stats->allocations_);
+  }
+  fflush(out);
+#else
+  fprintf(out, "Phase statistics need a build with -DESP_STATS\n");
+#endif
+}
@@ -0,0 +1,90 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#if defined(ESP_STATS) && defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "main.h"
+
+// phases of a turn the front-end spends its time in
+enum {
+  PHASE_INPUT,   // seat providing the move line
+  PHASE_PARSE,   // move line to Move
+  PHASE_APPLY,   // esp_apply, checking and making the move
+  PHASE_RENDER,  // turn, move, challenge and result output
+  PHASE_REFILL,  // streamed deck refills
+  PHASE_PERSIST, // results and saves
+  PHASE_COUNT
+};
+
+typedef struct _PhaseStats_
+{
+  uint64_t calls_;
+  uint64_t ticks_;        // TSC cycles on x86-64, nanoseconds elsewhere
+  uint64_t allocations_;  // only counted with ESP_COUNT_ALLOCATIONS
+} PhaseStats;
+
+typedef struct _PhaseMark_
+{
+  uint64_t ticks_;
+  size_t allocations_;
+} PhaseMark;
+
+// Builds with -DESP_STATS count the calls, time and allocations of every phase
+// per thread. Without it PHASE_START, PHASE_STOP and STATS_POLL are empty
+#ifdef ESP_STATS
+extern _Thread_local PhaseStats phase_stats[PHASE_COUNT];
+extern volatile sig_atomic_t stats_requested;
+
+//------------------------------------------------------------------------------
+///
+/// Current time of the phase timers
+///
+/// @return TSC cycles on x86-64, nanoseconds elsewhere
+//
+static inline uint64_t phaseTicks(void)
+{
+#ifdef __x86_64__
+  return __rdtsc();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+//------------------------------------------------------------------------------
+///
+/// Adding the calls, time and allocations since a mark to a phase
+///
+/// @param phase PHASE_*
+/// @param mark taken by PHASE_START when the phase began
+///
+/// @return no return
+//
+static inline void phaseStop(int phase, PhaseMark* mark)
+{
+  phase_stats[phase].calls_++;
+  phase_stats[phase].ticks_ += phaseTicks() - mark->ticks_;
+  phase_stats[phase].allocations_ += allocationCount() - mark->allocations_;
+}
+
+#define PHASE_START(mark) PhaseMark mark = { phaseTicks(), allocationCount() }
+#define PHASE_STOP(phase, mark) phaseStop(phase, &mark)
+#define STATS_POLL() do { if (stats_requested) { stats_requested = 0; printPhaseStats(stderr); } } while (0)
+#else
+#define PHASE_START(mark)
+#define PHASE_STOP(phase, mark)
+#define STATS_POLL()
+#endif
+
+int installStatsSignal(void);
+
+void printPhaseStats(FILE* out);
+
+#endif // STATS_H